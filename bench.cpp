@@ -0,0 +1,103 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "kul.bench.hpp"
+
+#include <new>
+#include <cstdlib>
+
+#if defined(_MSC_VER)
+#define KUL_BENCH_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define KUL_BENCH_NOINLINE __attribute__((noinline))
+#else
+#define KUL_BENCH_NOINLINE
+#endif
+
+/**
+	Every non aligned replaceable form goes through ALLOC/FREE so new and delete always pair up,
+	FREE stays out of line or the compiler sees free() on memory from operator new.
+*/
+namespace kul{ namespace bench{
+void* ALLOC(size_t s) noexcept{
+	ALLOCS()++;
+	return malloc(s ? s : 1);
+}
+KUL_BENCH_NOINLINE void FREE(void* p) noexcept{
+	free(p);
+}
+}}
+
+void* operator new(size_t s){
+	if(void* p = kul::bench::ALLOC(s)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t s){
+	if(void* p = kul::bench::ALLOC(s)) return p;
+	throw std::bad_alloc();
+}
+void* operator new(size_t s, const std::nothrow_t&) noexcept{
+	return kul::bench::ALLOC(s);
+}
+void* operator new[](size_t s, const std::nothrow_t&) noexcept{
+	return kul::bench::ALLOC(s);
+}
+void operator delete(void* p) noexcept{
+	kul::bench::FREE(p);
+}
+void operator delete[](void* p) noexcept{
+	kul::bench::FREE(p);
+}
+void operator delete(void* p, size_t) noexcept{
+	kul::bench::FREE(p);
+}
+void operator delete[](void* p, size_t) noexcept{
+	kul::bench::FREE(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept{
+	kul::bench::FREE(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept{
+	kul::bench::FREE(p);
+}
+
+int main(int argc, char* argv[]){
+	try{
+		kul::Bench();
+	}catch(const kul::Exception& e){ 
+		KERR << e.stack();
+	}catch(const std::exception& e){ 
+		KERR << e.what();
+	}catch(...){ 
+		KERR << "UNKNOWN EXCEPTION CAUGHT";
+	}
+	return 0;
+}
@@ -0,0 +1,302 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_BENCH_HPP_
+#define _KUL_BENCH_HPP_
+
+#include "kul/fs.hpp"
+#include "kul/io.hpp"
+#include "kul/log.hpp"
+#include "kul/proc.hpp"
+#include "kul/time.hpp"
+#include "kul/threads.hpp"
+
+namespace kul {
+namespace bench{
+// bench.cpp counts global operator new calls here
+inline std::atomic<uint64_t>& ALLOCS(){
+	static std::atomic<uint64_t> a(0);
+	return a;
+}
+}
+
+class Bench{
+	private:
+		static void RUN(const unsigned int& ts, const std::function<void()>& p, const std::function<void()>& c){
+			std::vector<std::shared_ptr<kul::Thread> > threads;
+			for(unsigned int i = 0; i < ts; i++){
+				threads.push_back(std::make_shared<kul::Thread>(p));
+				threads.push_back(std::make_shared<kul::Thread>(c));
+			}
+			for(const auto& t : threads) t->run();
+			for(const auto& t : threads) t->join();
+		}
+		static void REPORT(const std::string& s, const int64_t& ns, const uint64_t& ops){
+			KOUT(NON) << s << " : " << (ns / 1000000) << "ms : " << (ops * 1000000000 / (ns ? ns : 1)) << " ops/s";
+		}
+		void queueContention(const unsigned int& ts, const unsigned int& n){
+			const uint64_t ops = (uint64_t) ts * n;
+			{
+				kul::Mutex m;
+				std::queue<int> q;
+				std::atomic<uint64_t> popped(0);
+				const int64_t b = kul::Now::NANOS();
+				RUN(ts, [&](){
+					for(unsigned int i = 0; i < n; i++){
+						kul::ScopeLock lock(m);
+						q.push(i);
+					}
+				}, [&](){
+					while(popped < ops){
+						kul::ScopeLock lock(m);
+						if(q.empty()) continue;
+						q.pop();
+						popped++;
+					}
+				});
+				REPORT("Mutex + std::queue  (" + std::to_string(ts) + "x" + std::to_string(ts) + ")", kul::Now::NANOS() - b, ops);
+			}
+			{
+				kul::LockFreeQueue<int> q(1024);
+				std::atomic<uint64_t> popped(0);
+				const int64_t b = kul::Now::NANOS();
+				RUN(ts, [&](){
+					for(unsigned int i = 0; i < n; i++)
+						while(!q.push(i)) std::this_thread::yield();
+				}, [&](){
+					int v;
+					while(popped < ops)
+						if(q.pop(v)) popped++;
+						else std::this_thread::yield();
+				});
+				REPORT("kul::LockFreeQueue  (" + std::to_string(ts) + "x" + std::to_string(ts) + ")", kul::Now::NANOS() - b, ops);
+			}
+		}
+		static void REPORT(const std::string& s, const int64_t& ns, const uint64_t& ops, const uint64_t& as){
+			KOUT(NON) << s << " : " << (ns / (ops ? ops : 1)) << "ns/op : " << ((double) as / (ops ? ops : 1)) << " allocs/op";
+		}
+		void logFormat(const unsigned int& n){
+			const kul::Logger lg;
+			const std::string tr(kul::this_thread::id()), msg("benchmark message");
+			{
+				uint64_t as = bench::ALLOCS();
+				const int64_t b = kul::Now::NANOS();
+				for(unsigned int i = 0; i < n; i++){
+					std::string str(__KUL_LOG_FRMT__);
+					kul::String::replace(str, "%M", "INF");
+					kul::String::replace(str, "%T", tr);
+					kul::String::replace(str, "%D", kul::DateTime::NOW(__KUL_LOG_TIME_FRMT__));
+					kul::String::replace(str, "%F", __FILE__);
+					kul::String::replace(str, "%L", std::to_string(__LINE__));
+					kul::String::replace(str, "%S", msg);
+					str += kul::os::EOL();
+				}
+				REPORT("String::replace per line   ", kul::Now::NANOS() - b, n, bench::ALLOCS() - as);
+			}
+			{
+				std::string buf;
+				lg.format(buf, __FILE__, __LINE__, msg, kul::log::INF, tr, std::chrono::system_clock::now());
+				uint64_t as = bench::ALLOCS();
+				const int64_t b = kul::Now::NANOS();
+				for(unsigned int i = 0; i < n; i++){
+					buf.clear();
+					lg.format(buf, __FILE__, __LINE__, msg, kul::log::INF, tr, std::chrono::system_clock::now());
+				}
+				REPORT("kul::Logger::format        ", kul::Now::NANOS() - b, n, bench::ALLOCS() - as);
+			}
+		}
+		void timestamps(const unsigned int& n){
+			{
+				uint64_t as = bench::ALLOCS();
+				const int64_t b = kul::Now::NANOS();
+				for(unsigned int i = 0; i < n; i++) kul::DateTime::NOW(__KUL_LOG_TIME_FRMT__);
+				REPORT("kul::DateTime::NOW         ", kul::Now::NANOS() - b, n, bench::ALLOCS() - as);
+			}
+			{
+				std::string buf;
+				kul::time::Clock c(__KUL_LOG_TIME_FRMT__);
+				c.render(buf, std::chrono::system_clock::now());
+				uint64_t as = bench::ALLOCS();
+				const int64_t b = kul::Now::NANOS();
+				for(unsigned int i = 0; i < n; i++){
+					buf.clear();
+					c.render(buf, std::chrono::system_clock::now());
+				}
+				REPORT("kul::time::Clock::render   ", kul::Now::NANOS() - b, n, bench::ALLOCS() - as);
+			}
+		}
+		void reading(const uint64_t& mb){
+			kul::File f("kul.bench.txt", kul::env::CWD());
+			const std::string l(79, 'x');
+			const uint64_t n = mb * 1024 * 1024 / 80;
+			{
+				const int64_t b = kul::Now::NANOS();
+				{
+					kul::io::Writer w(f);
+					for(uint64_t i = 0; i < n; i++) w.write(l.c_str(), true);
+				}
+				REPORT("kul::io::Writer::write           (" + std::to_string(mb) + "MB)", kul::Now::NANOS() - b, n);
+			}
+			{
+				const int64_t b = kul::Now::NANOS();
+				{
+					kul::io::FastWriter w(f, __KUL_IO_BUFFER__, n * 80);
+					for(uint64_t i = 0; i < n; i++) w << l << '\n';
+				}
+				REPORT("kul::io::FastWriter              (" + std::to_string(mb) + "MB)", kul::Now::NANOS() - b, n);
+			}
+			uint64_t ls = 0;
+			{
+				const int64_t b = kul::Now::NANOS();
+				kul::io::Reader r(f);
+				while(r.readLine()) ls++;
+				REPORT("kul::io::Reader::readLine        (" + std::to_string(mb) + "MB)", kul::Now::NANOS() - b, ls);
+			}
+			{
+				ls = 0;
+				const int64_t b = kul::Now::NANOS();
+				std::string l;
+				kul::io::Reader r(f);
+				while(r.readLine(l)) ls++;
+				REPORT("kul::io::Reader::readLine(buffer)(" + std::to_string(mb) + "MB)", kul::Now::NANOS() - b, ls);
+			}
+			{
+				ls = 0;
+				const int64_t b = kul::Now::NANOS();
+				kul::io::Reader r(f);
+				for(const kul::StringView& l : r.lines()) if(l.size()) ls++;
+				REPORT("kul::io::Reader::lines           (" + std::to_string(mb) + "MB)", kul::Now::NANOS() - b, ls);
+			}
+			{
+				ls = 0;
+				const int64_t b = kul::Now::NANOS();
+				kul::StringView l;
+				kul::io::MappedReader r(f);
+				while(r.readLine(l)) ls++;
+				REPORT("kul::io::MappedReader::readLine  (" + std::to_string(mb) + "MB)", kul::Now::NANOS() - b, ls);
+			}
+			{
+				const int64_t b = kul::Now::NANOS();
+				kul::StringView c;
+				kul::io::MappedReader r(f);
+				for(ls = 0; r.read(c, 65536); ls++);
+				REPORT("kul::io::MappedReader::read 64KB (" + std::to_string(mb) + "MB)", kul::Now::NANOS() - b, ls);
+			}
+			f.rm();
+		}
+		void walking(const unsigned int& ds, const unsigned int& fs){
+			kul::Dir root("kul.bench.tree", kul::env::CWD());
+			for(unsigned int i = 0; i < ds; i++){
+				kul::Dir d("d" + std::to_string(i / 10), kul::Dir("d" + std::to_string(i % 10), root));
+				d.mk();
+				for(unsigned int j = 0; j < fs; j++) kul::File("f" + std::to_string(j), d).mk();
+			}
+			const uint64_t n = (uint64_t) ds * fs;
+			{
+				const int64_t b = kul::Now::NANOS();
+				if(root.files(true).size() != n) KERR << "Dir::files MISSED FILES";
+				REPORT("kul::Dir::files(true)           ", kul::Now::NANOS() - b, n);
+			}
+			for(unsigned int t = 1; t <= kul::cpu::threads() * 2; t *= 2){
+				std::atomic<uint64_t> c(0);
+				const int64_t b = kul::Now::NANOS();
+				kul::fs::Walker(root, true, false, t).walk([&](const std::string&, const char*, bool d){ if(!d) c++; });
+				if(c != n) KERR << "Walker MISSED FILES";
+				REPORT("kul::fs::Walker (" + std::to_string(t) + " threads)      ", kul::Now::NANOS() - b, n);
+			}
+			{
+				const kul::Dir d("d0", kul::Dir("d0", root));
+				std::vector<std::string> ns;
+				for(unsigned int j = 0; j < fs; j++) ns.push_back("f" + std::to_string(j));
+				uint64_t z = 0;
+				int64_t b = kul::Now::NANOS();
+				for(const std::string& f : ns){
+					const kul::File kf(f, d);
+					if(kf.is()) z += kf.size();
+				}
+				REPORT("kul::File::is + size            ", kul::Now::NANOS() - b, fs);
+				std::vector<kul::fs::Stat> ss;
+				b = kul::Now::NANOS();
+				kul::fs::DirHandle(d).stat(ns, ss);
+				REPORT("kul::fs::DirHandle::stat        ", kul::Now::NANOS() - b, fs);
+			}
+			{
+				const int64_t b = kul::Now::NANOS();
+				root.rm();
+				REPORT("kul::Dir::rm                    ", kul::Now::NANOS() - b, n);
+			}
+		}
+#ifndef _WIN32
+		class ForkedProcess : public kul::Process{
+			protected:
+				bool spawnable() const override { return false; }
+			public:
+				ForkedProcess(const std::string& cmd) : kul::Process(cmd){}
+		};
+		template <class P> static void SPAWN(const std::string& s, const unsigned int& n){
+			const int64_t b = kul::Now::NANOS();
+			for(unsigned int i = 0; i < n; i++){
+				P p("true");
+				kul::ProcessCapture pc(p);
+				p.start();
+			}
+			REPORT(s, kul::Now::NANOS() - b, n);
+		}
+		void spawning(const unsigned int& n){
+			SPAWN<ForkedProcess>("fork + execvp                ", n);
+			SPAWN<kul::Process> ("posix_spawn                  ", n);
+			std::vector<char> heap(512 * 1024 * 1024, 1); // touched pages fork has to map into the child
+			SPAWN<ForkedProcess>("fork + execvp    (512MB heap)", n);
+			SPAWN<kul::Process> ("posix_spawn      (512MB heap)", n);
+		}
+#endif
+	public:
+		Bench(){
+			KOUT(NON) << "LOG LINE FORMATTING";
+			logFormat(200000);
+			KOUT(NON) << "TIMESTAMPS";
+			timestamps(200000);
+			KOUT(NON) << "QUEUE CONTENTION - PRODUCERS x CONSUMERS";
+			for(unsigned int ts = 1; ts <= (kul::cpu::threads() > 1 ? kul::cpu::threads() : 2); ts *= 2)
+				queueContention(ts, 1000000 / ts);
+#ifndef _WIN32
+			KOUT(NON) << "PROCESS LAUNCHING - SPAWNS PER SECOND";
+			spawning(500);
+#endif
+			KOUT(NON) << "DIRECTORY WALKING - FILES PER SECOND";
+			walking(100, 200);
+			KOUT(NON) << "FILE WRITING AND READING - LINES OR CHUNKS PER SECOND";
+			const std::string mb(kul::env::GET("KUL_BENCH_IO_MB"));
+			reading(mb.empty() ? 256 : std::stoull(mb));
+		}
+};
+
+}
+#endif /* _KUL_BENCH_HPP_ */
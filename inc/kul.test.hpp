@@ -33,6 +33,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "kul/os.hpp"
 #include "kul/cli.hpp"
+#include "kul/fs.hpp"
+#include "kul/io.hpp"
 #include "kul/ipc.hpp"
 #include "kul/log.hpp"
 #include "kul/math.hpp"
@@ -42,6 +44,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "kul/string.hpp"
 #include "kul/wstring.hpp"
 #include "kul/threads.hpp"
+#include "kul/io.async.hpp"
 
 #include <iomanip>
 
@@ -97,6 +100,32 @@ class TestThreadPoolQObject : public TestThreadPoolObject{
 		void print(){ KLOG(INF) << "i = " << i;}
 };
 
+class TestThreadPoolLFQObject{
+	private:
+		std::atomic<int> i;
+		kul::LockFreeQueue<int>& q;
+	public:
+		TestThreadPoolLFQObject(kul::LockFreeQueue<int>& q) : i(0), q(q){}
+		void operator()(){
+			int v;
+			if(q.pop(v)) i++;
+		}
+		void print(){ KLOG(INF) << "i = " << i;}
+		int popped() const { return i; }
+};
+
+class TestThreadPoolNested{
+	private:
+		std::atomic<int>& k;
+	public:
+		TestThreadPoolNested(std::atomic<int>& k) : k(k){}
+		void operator()(){
+			kul::ThreadPool tp([this](){ k++; });
+			tp.setMax(2);
+			tp.join();
+		}
+};
+
 class TestIPCServer : public kul::ipc::Server{
 	public:
 		TestIPCServer() : kul::ipc::Server("uuid", 1){} // UUID 	CHECKS ONCE
@@ -122,6 +151,20 @@ class TestIPC{
 		}
 };
 
+class TestProcessCapture : public kul::ProcessCapture{
+	private:
+		size_t n = 0;
+	protected:
+		using kul::ProcessCapture::out;
+		void out(const std::string& s){
+			n += s.size();
+			kul::ProcessCapture::out(s);
+		}
+	public:
+		TestProcessCapture(kul::AProcess& p) : kul::ProcessCapture(p){ strings(); }
+		const size_t& seen() const { return n; }
+};
+
 class Catch{
 	public:
 		void print(const int& s){
@@ -141,6 +184,9 @@ class Test{
 			KLOG(INF) << "KLOG(INF)";
 			KLOG(ERR) << "KLOG(ERR)";
 			KLOG(DBG) << "KLOG(DBG)";
+			int evals = 0;
+			KLOG(DBG) << "KLOG(DBG) EVALUATED " << ++evals;
+			if(!kul::LogMan::INSTANCE().dbg() && evals) KERR << "DISABLED KLOG(DBG) ARGUMENTS EVALUATED";
 			KOUT(NON) << kul::Dir::SEP();
 			KOUT(NON) << kul::env::SEP();
 			KOUT(NON) << kul::env::CWD();
@@ -155,6 +201,104 @@ class Test{
 				KERR << e.debug()<< " : " << typeid(e).name();
 				KERR << "Error expected on windows without echo on path";
 			}
+			{
+				kul::proc::Chunks c(7);
+				const std::string a("0123456789abcdefghij");
+				c.append(a.data(), 5);
+				c.append(a.data() + 5, a.size() - 5);
+				kul::proc::Chunks d(c);
+				if(c.views().size() != 3 || c.views()[2] != kul::StringView("efghij") || d.str() != a)
+					KERR << "CHUNKS MISMATCH: " << d.str();
+			}
+#ifndef _WIN32
+			{
+				kul::Process p("sh", kul::env::CWD());
+				kul::ProcessCapture pc(p);
+				p.arg("-c").arg("echo $KUL_PROC_VAR; pwd; echo ERR >&2").var("KUL_PROC_VAR", "SPAWNED").start();
+				if(pc.outs() != "SPAWNED\n" + kul::env::CWD() + "\n") KERR << "PROCESS OUT MISMATCH: " << pc.outs();
+				if(pc.errs() != "ERR\n") KERR << "PROCESS ERR MISMATCH: " << pc.errs();
+			}
+			try{
+				kul::Process p("kul.no.such.binary");
+				kul::ProcessCapture pc(p);
+				p.start();
+				KERR << "MISSING BINARY DID NOT FAIL";
+			}catch(const kul::proc::Exception& e){}
+			{
+				kul::Process p("seq");
+				kul::ProcessCapture pc(p);
+				p.arg(1).arg(100000).start();
+				if(pc.outs().size() != 588895) KERR << "PROCESS OUTPUT SIZE MISMATCH: " << pc.outs().size();
+				size_t z = 0;
+				for(const kul::StringView& v : pc.outv()) z += v.size();
+				if(z != 588895 || pc.outv()[0] != kul::StringView(pc.outs().substr(0, pc.outv()[0].size())))
+					KERR << "PROCESS OUTPUT VIEWS MISMATCH: " << z;
+			}
+			{
+				kul::Process p("seq");
+				TestProcessCapture pc(p);
+				p.arg(1000).start();
+				if(pc.seen() != 3893 || pc.outs().size() != 3893) KERR << "PROCESS CAPTURE OVERRIDE MISSED: " << pc.seen();
+			}
+			{
+				size_t z = 0;
+				kul::Process p("seq");
+				p.setOutBuffer([&](const char*, size_t n){ z += n; });
+				p.arg(100000).start();
+				if(z != 588895) KERR << "PROCESS OUTPUT BUFFER MISMATCH: " << z;
+			}
+			{
+#ifdef RUSAGE_THREAD
+				// cpu time of this thread only, other threads of the test binary may be busy
+				const auto cpu = [](){
+					struct rusage r;
+					getrusage(RUSAGE_THREAD, &r);
+					return (int64_t) (r.ru_utime.tv_sec + r.ru_stime.tv_sec) * 1000 + (r.ru_utime.tv_usec + r.ru_stime.tv_usec) / 1000;
+				};
+				const int64_t c = cpu();
+#endif
+				const int64_t b = kul::Now::MILLIS();
+				kul::Process p("sh");
+				kul::ProcessCapture pc(p);
+				p.arg("-c").arg("sleep 2 & sleep 0.3; echo DONE").start();
+				if(pc.outs() != "DONE\n") KERR << "PROCESS OUT MISMATCH: " << pc.outs();
+				if(kul::Now::MILLIS() - b > 1500) KERR << "PROCESS WAITED ON GRANDCHILD";
+#ifdef RUSAGE_THREAD
+				if(cpu() - c > 100) KERR << "PROCESS PUMP BUSY WAITING";
+#endif
+				const kul::proc::Usage& u(p.usage());
+				if(u.wall() < 300000000 || u.wall() > 1500000000 || u.maxRSS() == 0 || u.start() <= 0)
+					KERR << "PROCESS USAGE MISMATCH: " << u.wall() << " " << u.maxRSS();
+			}
+			{
+				std::atomic<int> done(0), failed(0);
+				kul::proc::Usage total;
+				std::vector<std::shared_ptr<kul::ProcessCapture> > pcs;
+				{
+					kul::ProcessGroup g(3);
+					for(int i = 0; i < 8; i++){
+						std::shared_ptr<kul::Process> p(std::make_shared<kul::Process>("sh"));
+						p->arg("-c").arg("sleep 0.1; echo " + std::to_string(i) + "; exit " + std::to_string(i == 5 ? 3 : 0));
+						pcs.push_back(std::make_shared<kul::ProcessCapture>(*p));
+						g.add(p, [&](kul::Process& p, const std::exception_ptr& e){
+							total += p.usage();
+							done++;
+							if(!e) return;
+							try{ std::rethrow_exception(e); }
+							catch(const kul::proc::ExitException& e){ if(e.code() == 3 && p.exitCode() == 3) failed++; }
+						});
+					}
+					g.add(std::make_shared<kul::Process>("kul.no.such.binary"), [&](kul::Process&, const std::exception_ptr& e){
+						if(e) failed++;
+					});
+					g.wait();
+				}
+				if(done != 8 || failed != 2) KERR << "PROCESS GROUP CALLBACKS MISMATCH " << done << " " << failed;
+				if(total.wall() < 300000000 || total.user() + total.system() == 0) KERR << "PROCESS GROUP USAGE MISMATCH: " << total.wall();
+				for(size_t i = 0; i < pcs.size(); i++)
+					if(pcs[i]->outs() != std::to_string(i) + "\n") KERR << "PROCESS GROUP OUTPUT MISMATCH: " << pcs[i]->outs();
+			}
+#endif
 
 			for(const std::string& arg : kul::cli::asArgs("/path/to \"words in quotes\" words\\ not\\ in\\ quotes end"))
 				KOUT(NON) << "ARG: " << arg;
@@ -170,11 +314,115 @@ class Test{
 			if(!file && !file.mk()) KERR << "CANNOT CREATE FILE " << file;
 			if(file && !file.rm())  KERR << "CANNOT DELETE FILE " << file;
 
+			{
+				kul::File lf("kul.lines", kul::env::CWD());
+				{
+					kul::io::Writer w(lf);
+					for(int i = 0; i < 1000; i++) w << "LINE " << i << "\n";
+					w << "LAST LINE WITHOUT NEWLINE";
+				}
+				int ls = 0;
+				kul::StringView l;
+				kul::io::MappedReader mr(lf);
+				while(mr.readLine(l)) ls++;
+				if(ls != 1001 || l != kul::StringView("LAST LINE WITHOUT NEWLINE")) KERR << "MAPPED READER LINES " << ls;
+				std::string rl;
+				kul::io::Reader rd(lf);
+				for(const kul::StringView& v : rd.lines()) if(v.size() && --ls == 1) break;
+				if(!rd.readLine(rl) || rl != "LAST LINE WITHOUT NEWLINE" || rd.readLine(rl)) KERR << "READER LINES " << ls;
+				lf.rm();
+				{
+					kul::io::FastWriter fw(lf, 64, 4096);
+					for(int i = 0; i < 100; i++) fw << "FAST LINE " << i << '\n';
+					fw.sync();
+				}
+				ls = 0;
+				kul::io::MappedReader fr(lf);
+				for(const kul::StringView& v : fr.lines()) if(v == kul::StringView("FAST LINE " + std::to_string(ls))) ls++;
+				if(ls != 100) KERR << "FAST WRITER LINES " << ls;
+				lf.rm();
+			}
+			{
+				kul::Dir src("kul.cp.src", kul::env::CWD()), dst("kul.cp.dst", kul::env::CWD());
+				for(int i = 0; i < 4; i++){
+					kul::Dir sub("sub" + std::to_string(i), src);
+					sub.mk();
+					for(int j = 0; j < 8; j++) kul::io::Writer(kul::File("f" + std::to_string(j), sub)) << "COPY " << i << j;
+				}
+				for(unsigned int t = 1; t <= 4; t += 3){
+					std::vector<kul::File> wfs;
+					std::vector<kul::Dir> wds;
+					kul::fs::Walker(src, true, false, t).walk(wfs, wds);
+					if(wfs.size() != 32 || wds.size() != 4) KERR << "WALKER FOUND " << wfs.size() << " FILES " << wds.size() << " DIRS";
+				}
+				if(!src.cp(dst)) KERR << "DIR COPY FAILED";
+				const kul::File cf("f7", kul::Dir("sub3", kul::Dir(src.name(), dst)));
+				kul::io::Reader cr(cf);
+				const std::string* cl = cr.readLine();
+				if(!cl || *cl != "COPY 37" || kul::Dir(src.name(), dst).files(true).size() != 32) KERR << "DIR COPY MISMATCH";
+				{
+					std::shared_ptr<kul::fs::DirHandle> dh(std::make_shared<kul::fs::DirHandle>(src));
+					kul::fs::DirHandle sub(*dh, "sub0");
+					std::vector<kul::fs::Stat> ss;
+					sub.stat({"f0", "f1", "none"}, ss);
+					if(!ss[0].exists() || ss[1].size() != 7 || ss[2].exists()) KERR << "DIR HANDLE STAT MISMATCH";
+					kul::fs::FileHandle fh(std::make_shared<kul::fs::DirHandle>(*dh, "sub1"), "f2");
+					if(!fh.is() || fh.size() != 7 || !fh.rm() || fh.is()) KERR << "FILE HANDLE MISMATCH";
+				}
+				{
+					int cs[3] = {0, 0, 0};
+					const kul::File tf("kul.tsi", kul::env::CWD());
+					auto count = [&](const std::string&, kul::fs::TimeStampIndex::Change c){ cs[c]++; };
+					{
+						kul::fs::TimeStampIndex tsi(tf);
+						tsi.diff(src, count);
+						tsi.save();
+					}
+					kul::fs::TimeStampIndex tsi(tf);
+					kul::io::Writer(kul::File("f0", kul::Dir("sub0", src)), true) << "MORE";
+					kul::File("f1", kul::Dir("sub0", src)).rm();
+					tsi.diff(src, count, 2);
+					if(tsi.size() != 31 || cs[0] != 31 || cs[1] != 1 || cs[2] != 1) KERR << "TIMESTAMP INDEX " << cs[0] << " " << cs[1] << " " << cs[2];
+					tf.rm();
+				}
+				src.rm();
+				if(src.is()) KERR << "DIR RM FAILED";
+				if(!kul::fs::Remover().detach(dst) || dst.is()) KERR << "DIR DETACHED RM FAILED";
+			}
+			{
+				kul::File sf("kul.stat", kul::env::CWD());
+				kul::fs::StatCache& sc(kul::fs::StatCache::INSTANCE());
+				sf.mk();
+				if(!sc.stat(sf.full()).exists() || sc.stat(sf.full()).directory()) KERR << "STAT CACHE MISSED FILE";
+				sf.rm();
+				if(sc.stat(sf.full()).exists()) KERR << "STAT CACHE NOT INVALIDATED";
+			}
+			{
+				kul::File af("kul.async", kul::env::CWD());
+				{
+					const std::string a(4096, 'a');
+					std::vector<char> b(a.size());
+					kul::io::MemoryMap mm(af.full(), 8192);
+					kul::io::AsyncIO& aio(kul::io::AsyncIO::INSTANCE());
+					std::future<long> w = aio.write(mm.descriptor(), a.data(), a.size(), 4096);
+					aio.submit();
+					w.get();
+					std::future<long> r = aio.read(mm.descriptor(), b.data(), b.size(), 4096);
+					aio.submit();
+					if(r.get() != 4096 || std::string(b.begin(), b.end()) != a) KERR << "ASYNC IO MISMATCH";
+				}
+				af.rm();
+			}
+
 			KOUT(NON) << "kul::Now::MILLIS(); " << kul::Now::MILLIS();
 			KOUT(NON) << "kul::Now::MICROS(); " << kul::Now::MICROS();
 			KOUT(NON) << "kul::Now::NANOS();  " << kul::Now::NANOS();
 
 			KOUT(NON) << "kul::DateTime::NOW();  " << kul::DateTime::NOW();
+			kul::time::Clock clock("%Y-%m-%d-%H:%M:%S.%f");
+			KOUT(NON) << "kul::time::Clock::render();  " << clock.render();
+			KOUT(NON) << "kul::time::Monotonic::NANOS();  " << kul::time::Monotonic::NANOS();
+			KOUT(NON) << "kul::time::Monotonic::COARSE(); " << kul::time::Monotonic::COARSE();
 
 			KOUT(NON) << "CPU CORES:   " << kul::cpu::cores();
 			KOUT(NON) << "MAX THREADS: " << kul::cpu::threads();
@@ -197,6 +445,7 @@ class Test{
 
 			TestThreadObject tto3;
 			kul::Thread th1(tto3);
+			th1.name("kul.test");
 			th1.detach();
 			th1.join();
 			tto3.print();
@@ -208,6 +457,18 @@ class Test{
 				}
 				kul::ScopeLock lock(mutex);
 			}
+			{
+				kul::FastMutex fm;
+				kul::threading::ScopedLock<kul::FastMutex> lock(fm);
+			}
+			{
+				kul::SharedMutex sm;
+				{
+					kul::ScopeReadLock r1(sm);
+					kul::ScopeReadLock r2(sm);
+				}
+				kul::threading::ScopedLock<kul::SharedMutex> lock(sm);
+			}
 
 			KOUT(NON) << "LAUNCHING THREAD POOL";
 			TestThreadPoolObject ttpo1(mutex);
@@ -228,9 +489,74 @@ class Test{
 			tp2.detach();
 			tp2.join();
 			ttpo2.print();
+			for(const auto& t : tp2.taskTimes())
+				KLOG(DBG) << "TASK WAITED " << t.waited() << "ns RAN " << t.ran() << "ns";
+
+			kul::LockFreeQueue<int> lfq(16);
+			for(int i = 0; i < 10; i++) lfq.push(i);
+			KOUT(NON) << "LAUNCHING LOCK FREE PREDICATED THREAD POOL";
+			TestThreadPoolLFQObject ttpo3(lfq);
+			kul::Ref<TestThreadPoolLFQObject> ref4(ttpo3);
+			kul::PredicatedThreadPool<kul::LockFreeQueue<int> > tp3(ref4, lfq);
+			tp3.setMax(kul::cpu::threads());
+			tp3.join();
+			ttpo3.print();
+			if(ttpo3.popped() != 10 || !lfq.empty()) KERR << "LOCK FREE QUEUE POPPED " << ttpo3.popped() << " LEFT " << lfq.size();
+
+			{
+				std::atomic<int> k(0);
+				TestThreadPoolNested nested(k);
+				kul::Ref<TestThreadPoolNested> ref(nested);
+				kul::ThreadPool tp(ref);
+				tp.setMax(2);
+				tp.join();
+				if(k != 4) KERR << "NESTED THREAD POOL RAN " << k;
+			}
+			{
+				const int m = kul::Executor::INSTANCE().workers() + 2;
+				std::atomic<int> r(0);
+				kul::ThreadPool tp([&](){
+					r++;
+					for(int i = 0; i < 500 && r < m; i++) kul::this_thread::sleep(10);
+				});
+				tp.setMax(m);
+				tp.join();
+				if(r != m) KERR << "THREAD POOL BEYOND EXECUTOR WORKERS RAN " << r;
+			}
+			{
+				const int m = kul::Executor::INSTANCE().workers() + 1;
+				std::shared_ptr<std::atomic<int> > r(std::make_shared<std::atomic<int> >(0));
+				std::shared_ptr<std::atomic<bool> > go(std::make_shared<std::atomic<bool> >(0));
+				{
+					kul::ThreadPool tp([r, go](){
+						for(int i = 0; i < 500 && !*go; i++) kul::this_thread::sleep(10);
+						(*r)++;
+					});
+					tp.setMax(m);
+					tp.detach();
+					tp.run();
+				}
+				if(*r) KERR << "DETACHED THREAD POOL BLOCKED ON DESTRUCTION";
+				*go = 1;
+				for(int i = 0; i < 500 && *r < m; i++) kul::this_thread::sleep(10);
+				if(*r != m) KERR << "DETACHED THREAD POOL RAN " << *r;
+			}
+			std::future<int> fu = kul::Executor::INSTANCE().submit([](){ return 42; });
+			KOUT(NON) << "EXECUTOR RETURNED " << fu.get();
 
 			TestIPC().run();
 
+			{
+				kul::log::BinarySink bs("./kul.blog", 4096);
+				for(int i = 0; i < 100; i++) bs.write(__FILE__, __LINE__, kul::log::INF, kul::this_thread::id(), "BINARY RECORD " + std::to_string(i));
+			}
+			kul::log::BinaryDecoder("./kul.blog").decode([](const std::string& s){ KOUT(NON) << "DECODED " << s.substr(0, s.size() - 1); });
+			kul::File("kul.blog", kul::env::CWD()).rm();
+			kul::File("kul.blog.sites", kul::env::CWD()).rm();
+
+			kul::LogMan::INSTANCE().async(kul::log::COUNT);
+			KLOG(INF) << "ASYNC LOGGING ENABLED";
+
 			KOUT(NON) << kul::math::abs(-1);
 
 			KOUT(NON) << kul::math::root(16);
@@ -49,10 +49,11 @@ class CompilerProcessCapture : public kul::ProcessCapture{
 	private:
 		std::exception_ptr ep;
 		std::string c, t;
+		kul::proc::Usage u;
 	public:
 		CompilerProcessCapture() : ep(){}
 		CompilerProcessCapture(kul::AProcess& p) : kul::ProcessCapture(p), ep(){}
-		CompilerProcessCapture(const CompilerProcessCapture& cp) : kul::ProcessCapture(cp), ep(cp.ep), c(cp.c), t(cp.t){}
+		CompilerProcessCapture(const CompilerProcessCapture& cp) : kul::ProcessCapture(cp), ep(cp.ep), c(cp.c), t(cp.t), u(cp.u){}
 
 		void exception(const std::exception_ptr& e)	{ ep = e; }
 		const std::exception_ptr& exception() const	{ return ep; }
@@ -62,6 +63,10 @@ class CompilerProcessCapture : public kul::ProcessCapture{
 
 		void tmp(const std::string& tm) { this->t = tm; }
 		const std::string& tmp() const 	{ return t; }
+
+		/** resources of the compile or link, sum with kul::proc::Usage::operator+= for totals */
+		void usage(const kul::proc::Usage& us)	{ this->u = us; }
+		const kul::proc::Usage& usage() const 	{ return u; }
 };
 
 class Compiler{	
@@ -94,6 +99,18 @@ class Compiler{
 			const std::string& in, 
 			const std::string& out, 
 			const Mode& mode) 	const throw (kul::Exception) = 0;
+		/** queues the compile on g, c receives the capture after exit, compilers without support compile here */
+		virtual void compileSource	(
+			kul::ProcessGroup&,
+			const std::function<void(const CompilerProcessCapture&)>& c,
+			const std::string& compiler,
+			const std::vector<std::string>& args,
+			const std::vector<std::string>& incs,
+			const std::string& in,
+			const std::string& out,
+			const Mode& mode) 	const throw (kul::Exception){
+			c(compileSource(compiler, args, incs, in, out, mode));
+		}
 		virtual void preCompileHeader(
 			const std::vector<std::string>& incs, 
 			const hash::set::String& args, 
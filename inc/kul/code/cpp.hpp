@@ -53,6 +53,26 @@ class CCompiler : public Compiler{
 };
 
 class GCCompiler : public CCompiler{
+	private:
+		static std::shared_ptr<kul::Process> compileProcess(
+			const std::string& compiler,
+			const std::vector<std::string>& args,
+			const std::vector<std::string>& incs,
+			const std::string& in,
+			const std::string& out){
+			std::string cmd = compiler;
+			std::vector<std::string> bits;
+			if(compiler.find(" ") != std::string::npos){
+				bits = kul::String::split(compiler, ' ');
+				cmd = bits[0];
+			}
+			std::shared_ptr<kul::Process> p(std::make_shared<kul::Process>(cmd));
+			for(unsigned int i = 1; i < bits.size(); i++) p->arg(bits[i]);
+			for(const std::string& s : incs) p->arg("-I"+s);
+			for(const std::string& s : args) p->arg(s);
+			p->arg("-o").arg(out).arg("-c").arg(in);
+			return p;
+		}
 	public:
 		GCCompiler(const int& v = 0) : CCompiler(v){}
 		const std::string sharedLib(const std::string& lib) const {
@@ -92,6 +112,7 @@ class GCCompiler : public CCompiler{
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(out);
+			pc.usage(p.usage());
 			pc.cmd(p.toString());
 			return pc; 
 		}
@@ -125,6 +146,7 @@ class GCCompiler : public CCompiler{
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(lib);
+			pc.usage(p.usage());
 			pc.cmd(p.toString());
 			return pc; 
 		}
@@ -136,27 +158,38 @@ class GCCompiler : public CCompiler{
 			const std::string& out, 
 			const Mode& mode) const throw (kul::Exception){ 
 
-			std::string cmd = compiler;
-			std::vector<std::string> bits;
-			if(compiler.find(" ") != std::string::npos){
-				bits = kul::String::split(compiler, ' ');
-				cmd = bits[0];
-			}
-			kul::Process p(cmd);
-			for(unsigned int i = 1; i < bits.size(); i++) p.arg(bits[i]);
-			for(const std::string& s : incs) p.arg("-I"+s);
-			for(const std::string& s : args) p.arg(s);
-			p.arg("-o").arg(out).arg("-c").arg(in);
-			CompilerProcessCapture pc(p);
+			std::shared_ptr<kul::Process> p(compileProcess(compiler, args, incs, in, out));
+			CompilerProcessCapture pc(*p);
 			try{
-				p.start();
+				p->start();
 			}catch(const kul::proc::Exception& e){
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(out);
-			pc.cmd(p.toString());
+			pc.usage(p->usage());
+			pc.cmd(p->toString());
 			return pc;
 		}
+		void compileSource(
+			kul::ProcessGroup& g,
+			const std::function<void(const CompilerProcessCapture&)>& c,
+			const std::string& compiler, 
+			const std::vector<std::string>& args, 
+			const std::vector<std::string>& incs,
+			const std::string& in, 
+			const std::string& out, 
+			const Mode& mode) const throw (kul::Exception){ 
+
+			std::shared_ptr<kul::Process> p(compileProcess(compiler, args, incs, in, out));
+			std::shared_ptr<CompilerProcessCapture> pc(std::make_shared<CompilerProcessCapture>(*p));
+			pc->tmp(out);
+			pc->cmd(p->toString());
+			g.add(p, [pc, c](kul::Process& p, const std::exception_ptr& e){
+				if(e) pc->exception(e);
+				pc->usage(p.usage());
+				c(*pc);
+			});
+		}
 		virtual void preCompileHeader(			
 			const std::vector<std::string>& incs,
 			const hash::set::String& args, 
@@ -265,6 +298,7 @@ class WINCompiler : public CCompiler{
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(exe);
+			pc.usage(p.usage());
 			pc.cmd(p.toString());
 			return pc; 
 		}
@@ -303,6 +337,7 @@ class WINCompiler : public CCompiler{
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(lib);
+			pc.usage(p.usage());
 			pc.cmd(p.toString());
 			return pc; 
 		}
@@ -334,6 +369,7 @@ class WINCompiler : public CCompiler{
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(out);
+			pc.usage(p.usage());
 			pc.cmd(p.toString());
 			return pc;
 		}
@@ -89,6 +89,7 @@ class WINCompiler : public Compiler{
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(exe);
+			pc.usage(p.usage());
 			pc.cmd(p.toString());
 			return pc;
 		}
@@ -121,6 +122,7 @@ class WINCompiler : public Compiler{
 				pc.exception(std::current_exception());
 			}
 			pc.tmp(dll);
+			pc.usage(p.usage());
 			pc.cmd(p.toString());
 			return pc;
 		}
@@ -43,6 +43,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif /*  ulonglong */
 
 
+#ifndef __KUL_CACHE_LINE__
+	#define __KUL_CACHE_LINE__ 64
+#endif /*  __KUL_CACHE_LINE__ */
+
+#ifndef __KUL_IO_BUFFER__
+	#define __KUL_IO_BUFFER__ 65536
+#endif /*  __KUL_IO_BUFFER__ */
+
 #define KSTRINGIFY(x) #x
 #define KTOSTRING(x) KSTRINGIFY(x)
 
@@ -0,0 +1,416 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_FS_HPP_
+#define _KUL_FS_HPP_
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "kul/io.hpp"
+#include "kul/os.hpp"
+#include "kul/fs.os.hpp"
+#include "kul/threads.hpp"
+
+namespace kul{ namespace fs {
+
+/**
+	Lists a directory tree in one pass, taking entry types from the directory entries and
+	opening subdirectories relative to their parent's descriptor instead of by joined path.
+	Hidden directories are skipped unless h, files are always reported as with Dir::files.
+	With p above 1 subdirectories are listed breadth first on a TaskGroup of p, the callback
+	is then called from several threads at once.
+*/
+class Walker{
+	private:
+		bool r, h;
+		unsigned int p;
+		Dir d;
+		typedef std::function<void(const std::string&, const char*, bool)> Callback;
+		void list(const Listing::Handle& hd, const std::string& s, const Callback& f, TaskGroup* g) const {
+			std::vector<std::string> ns;
+			Listing::LIST(hd, [&](const char* n, bool isd){
+				if(isd && !h && n[0] == '.') return;
+				f(s, n, isd);
+				if(isd && r) ns.push_back(n);
+			});
+			if(g){
+				// children open by path inside their task, so open handles stay bounded by the task count
+				Listing::CLOSE(hd);
+				for(const std::string& n : ns){
+					const std::string cs(Dir::JOIN(s, n));
+					g->add([this, cs, &f, g](){
+						const Listing::Handle c = Listing::OPEN(Listing::NONE(), cs.c_str());
+						if(Listing::VALID(c)) list(c, cs, f, g);
+					});
+				}
+				return;
+			}
+			for(const std::string& n : ns){
+				const Listing::Handle c = Listing::OPEN(hd, n.c_str());
+				if(Listing::VALID(c)) list(c, Dir::JOIN(s, n), f, 0);
+			}
+			Listing::CLOSE(hd);
+		}
+	public:
+		Walker(const Dir& d, bool r = true, bool h = false, const unsigned int& p = 1) : r(r), h(h), p(p), d(d){}
+		// f(const std::string& parent, const char* name, bool directory)
+		void walk(const Callback& f) const throw(fs::Exception){
+			const Listing::Handle hd = Listing::OPEN(Listing::NONE(), d.path().c_str());
+			if(!Listing::VALID(hd)) KEXCEPT(fs::Exception, "Directory : \"" + d.path() + "\" does not exist");
+			if(p < 2) return list(hd, d.path(), f, 0);
+			TaskGroup g(p);
+			list(hd, d.path(), f, &g);
+			g.wait();
+		}
+		void walk(std::vector<File>& fs, std::vector<Dir>& ds) const throw(fs::Exception){
+			std::mutex m;
+			walk([&](const std::string& s, const char* n, bool isd){
+				std::unique_lock<std::mutex> l(m, std::defer_lock);
+				if(p > 1) l.lock();
+				if(isd) ds.push_back(Dir(Dir::JOIN(s, n)));
+				else    fs.push_back(File(n, s));
+			});
+		}
+};
+
+/**
+	Deletes directory trees in parallel, see KulDirRemover.
+	detach() renames the tree to a hidden sibling and deletes it on the Executor,
+	returning once the rename is done. Trees still being deleted at exit are finished
+	when the Executor shuts down.
+*/
+class Remover{
+	private:
+		unsigned int p;
+	public:
+		Remover(const unsigned int& p = kul::cpu::threads()) : p(p){}
+		bool rm(const Dir& d) const {
+			return d.is() && KulDirRemover::RM(d.path(), p);
+		}
+		bool detach(const Dir& d) const {
+			if(!d.is()) return 0;
+			static std::atomic<uint64_t> n(0);
+			const Dir r(d.real());
+			const std::string t(r.parent().join("." + r.name() + ".kul.rm."
+				+ std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "." + std::to_string(n++)));
+			if(std::rename(r.path().c_str(), t.c_str())) return 0;
+			const unsigned int p(this->p);
+			Executor::INSTANCE().submit([t, p](){ KulDirRemover::RM(t, p); });
+			return 1;
+		}
+};
+
+/**
+	Directory held open as a handle, O_PATH on linux, so metadata queries, removal and
+	nested handles resolve names relative to it with one syscall and no path joins.
+	stat(names) looks up many entries in one call for exists/size/modified checks.
+*/
+class DirHandle{
+	private:
+		Listing::Handle h;
+		Dir d;
+	public:
+		DirHandle(const Dir& d) throw(fs::Exception) : h(Listing::PATH(Listing::NONE(), d.path().c_str())), d(d){
+			if(!Listing::VALID(h)) KEXCEPT(fs::Exception, "Directory : \"" + d.path() + "\" does not exist");
+		}
+		DirHandle(const DirHandle& p, const std::string& n) throw(fs::Exception) : h(Listing::PATH(p.h, n.c_str())), d(n, p.d){
+			if(!Listing::VALID(h)) KEXCEPT(fs::Exception, "Directory : \"" + d.path() + "\" does not exist");
+		}
+		~DirHandle(){ Listing::CLOSE(h); }
+		DirHandle(const DirHandle&) = delete;
+		DirHandle& operator=(const DirHandle&) = delete;
+
+		const Dir& dir() const { return d; }
+		const Stat stat(const std::string& n) const {
+			return Stat::AT(h, n.c_str());
+		}
+		void stat(const std::vector<std::string>& ns, std::vector<Stat>& ss) const {
+			ss.resize(ns.size());
+			for(size_t i = 0; i < ns.size(); i++) ss[i] = Stat::AT(h, ns[i].c_str());
+		}
+		bool rm(const std::string& n) const {
+			return Listing::UNLINK(h, n.c_str(), 0);
+		}
+};
+
+/**
+	File named relative to a shared DirHandle, its Stat is taken once on first use
+	and kept until refresh().
+*/
+class FileHandle{
+	private:
+		std::string n;
+		std::shared_ptr<DirHandle> d;
+		mutable bool c;
+		mutable Stat s;
+		const Stat& stat() const {
+			if(!c){
+				s = d->stat(n);
+				c = 1;
+			}
+			return s;
+		}
+	public:
+		FileHandle(const std::shared_ptr<DirHandle>& d, const std::string& n) : n(n), d(d), c(0){}
+		bool is()					const { return stat().exists() && !stat().directory(); }
+		uint64_t size()				const { return stat().size(); }
+		int64_t modified()			const { return stat().modified(); }
+		bool rm(){
+			c = 0;
+			return d->rm(n);
+		}
+		void refresh()					{ c = 0; }
+		const std::string& name()	const { return n; }
+		const File file()			const { return File(n, d->dir()); }
+};
+
+/**
+	Process wide memo of stat and realpath results keyed by the path string as given.
+	The parent directory of every cached path is watched and any change inside it drops
+	its entries, so repeated queries do not reach the kernel. Pending changes are read at the
+	start of every query, so a change made before a call is always seen by it. Paths whose
+	parent cannot be watched, or platforms without a Watcher, are looked up every time.
+	Only the parent is watched: a cached directory's own stat is not dropped when entries
+	inside it change, and real() is not dropped when an ancestor above the parent is renamed
+	or relinked, call clear() for those. Relative paths are resolved against the working
+	directory, call clear() after changing it too.
+*/
+class StatCache{
+	private:
+		std::mutex m;
+		std::unordered_map<std::string, Stat> ss;
+		std::unordered_map<std::string, std::string> rs;
+		std::unordered_map<std::string, int> ds;
+		std::unordered_map<int, std::vector<std::string> > ws;
+		Watcher w;
+		// prefix of p up to and including its last separator
+		static std::string PARENT(const std::string& p){
+			const size_t s = p.find_last_of(Dir::SEP());
+			return s == std::string::npos ? std::string() : p.substr(0, s + 1);
+		}
+		bool watched(const std::string& p){
+			const std::string d(PARENT(p));
+			auto it = ds.find(d);
+			if(it == ds.end()){
+				const int wd = w.watch(d.empty() ? "." : d);
+				it = ds.insert(std::make_pair(d, wd)).first;
+				if(wd >= 0) ws[wd].push_back(d);
+			}
+			return it->second >= 0;
+		}
+		// called from w.drain() with m held
+		void changed(const int& wd, const char* n){
+			auto it = ws.find(wd);
+			if(it == ws.end()) return;
+			if(!n || !*n){
+				// the directory itself changed or went away, forget everything cached under it
+				for(const std::string& d : it->second){
+					for(auto i = ss.begin(); i != ss.end(); ) i = PARENT(i->first) == d ? ss.erase(i) : ++i;
+					for(auto i = rs.begin(); i != rs.end(); ) i = PARENT(i->first) == d ? rs.erase(i) : ++i;
+					if(!n) ds.erase(d);
+				}
+				if(!n) ws.erase(it);
+				return;
+			}
+			for(const std::string& d : it->second){
+				ss.erase(d + n);
+				rs.erase(d + n);
+			}
+		}
+	public:
+		StatCache() : w([this](const int& wd, const char* n){ changed(wd, n); }, [this](){ ss.clear(); rs.clear(); }){}
+		static StatCache& INSTANCE(){
+			static StatCache instance;
+			return instance;
+		}
+		const Stat stat(const std::string& p){
+			if(!w.ok()) return Stat::AT(Listing::NONE(), p.c_str());
+			std::lock_guard<std::mutex> l(m);
+			w.drain();
+			auto it = ss.find(p);
+			if(it != ss.end()) return it->second;
+			// watch before looking so no change can slip in between
+			const bool c = watched(p);
+			const Stat st(Stat::AT(Listing::NONE(), p.c_str()));
+			if(c) ss.insert(std::make_pair(p, st));
+			return st;
+		}
+		const std::string real(const std::string& p) throw(fs::Exception){
+			if(!w.ok()) return Dir::REAL(p);
+			std::lock_guard<std::mutex> l(m);
+			w.drain();
+			auto it = rs.find(p);
+			if(it != rs.end()) return it->second;
+			const bool c = watched(p);
+			const std::string r(Dir::REAL(p));
+			if(c) rs.insert(std::make_pair(p, r));
+			return r;
+		}
+		void clear(){
+			std::lock_guard<std::mutex> l(m);
+			ss.clear();
+			rs.clear();
+		}
+		bool watching() const { return w.ok(); }
+};
+
+/**
+	Persistent index of file timestamps keyed by path. Stored as a header, a table sorted by path
+	and the path bytes, so a later run maps the file and searches it in place without parsing.
+	diff() walks one tree against the index reporting f(path, change) for added, modified and
+	removed files, any difference in nanosecond mtime/ctime, inode or size counts as modified.
+	What diff() saw is written by save().
+*/
+class TimeStampIndex{
+	public:
+		enum Change { ADDED = 0, MODIFIED, REMOVED };
+	private:
+		static const uint64_t MAGIC = 0x4B554C5453495831;
+		class Entry{
+			public:
+				uint64_t o, l;
+				int64_t m, c;
+				uint64_t i, s;
+		};
+		class Record{
+			public:
+				std::string p;
+				Stat s;
+				bool operator<(const Record& r) const { return p < r.p; }
+		};
+		File f;
+		uint64_t n;
+		const Entry* es;
+		std::unique_ptr<io::MemoryMap> mm;
+		std::vector<Record> rs;
+		StringView path(const Entry& e) const { return StringView(mm->data() + e.o, e.l); }
+		static int COMPARE(const StringView& a, const std::string& b){
+			const int c = memcmp(a.data(), b.data(), a.size() < b.size() ? a.size() : b.size());
+			return c ? c : a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+		}
+		const Entry* find(const std::string& p) const {
+			uint64_t l = 0, h = n;
+			while(l < h){
+				const uint64_t m = (l + h) / 2;
+				const int c = COMPARE(path(es[m]), p);
+				if(c == 0) return &es[m];
+				if(c < 0) l = m + 1;
+				else h = m;
+			}
+			return 0;
+		}
+		void load(){
+			es = 0;
+			n = 0;
+			mm.reset();
+			if(!f) return;
+			try{
+				mm.reset(new io::MemoryMap(f.full()));
+			}catch(const fs::Exception&){ return; }
+			const uint64_t mg = MAGIC, z = mm->size();
+			const uint64_t* h = (const uint64_t*) mm->data();
+			if(!h || z < 16 || h[0] != mg || h[1] > (z - 16) / sizeof(Entry)) return;
+			const Entry* e = (const Entry*) (mm->data() + 16);
+			for(uint64_t i = 0; i < h[1]; i++) if(e[i].o > z || e[i].l > z - e[i].o) return;
+			es = e;
+			n = h[1];
+		}
+	public:
+		TimeStampIndex(const File& f) : f(f), n(0), es(0){ load(); }
+		TimeStampIndex(const TimeStampIndex&) = delete;
+		TimeStampIndex& operator=(const TimeStampIndex&) = delete;
+		const uint64_t& size() const { return n; }
+		template <class F> void diff(const Dir& d, F f, const unsigned int& t = 1){
+			std::mutex m;
+			std::vector<bool> seen(n);
+			rs.clear();
+			Walker(d, true, false, t).walk([&](const std::string& s, const char* nm, bool isd){
+				if(isd) return;
+				Record r;
+				r.p = Dir::JOIN(s, nm);
+				r.s = Stat::AT(Listing::NONE(), r.p.c_str());
+				const Entry* e = find(r.p);
+				std::lock_guard<std::mutex> l(m);
+				if(!e) f(r.p, ADDED);
+				else{
+					seen[e - es] = 1;
+					if(e->m != r.s.modified() || e->c != r.s.changed() || e->i != r.s.inode() || e->s != r.s.size())
+						f(r.p, MODIFIED);
+				}
+				rs.push_back(std::move(r));
+			});
+			const std::string pr(d.path() + Dir::SEP());
+			for(uint64_t i = 0; i < n; i++){
+				const StringView p(path(es[i]));
+				if(!seen[i] && p.size() > pr.size() && memcmp(p.data(), pr.data(), pr.size()) == 0) f(p.str(), REMOVED);
+			}
+		}
+		void save() throw(fs::Exception){
+			std::sort(rs.begin(), rs.end());
+			const File tmp(f.name() + ".tmp", f.dir());
+			{
+				io::FastWriter w(tmp);
+				const uint64_t h[2] = {MAGIC, rs.size()};
+				w.write((const char*) h, sizeof(h));
+				uint64_t o = sizeof(h) + rs.size() * sizeof(Entry);
+				for(const Record& r : rs){
+					Entry e;
+					e.o = o;
+					e.l = r.p.size();
+					e.m = r.s.modified();
+					e.c = r.s.changed();
+					e.i = r.s.inode();
+					e.s = r.s.size();
+					w.write((const char*) &e, sizeof(e));
+					o += e.l;
+				}
+				for(const Record& r : rs) w.write(r.p.data(), r.p.size());
+			}
+			mm.reset();
+#ifdef _WIN32
+			f.rm();
+#endif
+			if(std::rename(tmp.full().c_str(), f.full().c_str()))
+				KEXCEPT(fs::Exception, "File : \"" + f.full() + "\" cannot be written");
+			load();
+		}
+};
+
+}}
+#endif /* _KUL_FS_HPP_ */
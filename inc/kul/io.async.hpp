@@ -0,0 +1,230 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_IO_ASYNC_HPP_
+#define _KUL_IO_ASYNC_HPP_
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <unordered_set>
+
+#include "kul/io.hpp"
+#include "kul/threads.hpp"
+
+#ifdef __linux__
+#include "kul/io.ring.hpp"
+#endif
+
+namespace kul{ namespace io {
+
+/**
+	Batched reads and writes at file offsets returning std::future completion handles,
+	holding the bytes transferred or an io::Exception. Buffers must outlive the future.
+	On linux requests are queued on an io_uring ring until submit(), or until the ring is full,
+	so a batch costs a single syscall, and are completed by one reaper thread. If the ring
+	fails outright, pending futures throw and later requests run on the executor instead.
+	Elsewhere, or without kernel support, each request runs on a private kul::Executor,
+	so futures can be waited on from ThreadPool workers without starving the shared pool.
+*/
+class AsyncIO{
+	private:
+		const unsigned w;
+		std::unique_ptr<kul::Executor> ex;
+#ifdef __linux__
+		std::atomic<bool> s, f;
+		std::atomic<uint64_t> i;
+		kul::FastMutex m, pm;
+		std::unordered_set<std::promise<long>*> ps;
+		std::unique_ptr<Ring> r;
+		std::unique_ptr<kul::Thread> t;
+		static std::exception_ptr ERROR(const int& e){
+			return std::make_exception_ptr(Exception(__FILE__, __LINE__, "AsyncIO : request failed, errno " + std::to_string(e)));
+		}
+		static bool TRANSIENT(const int& e){ return e == EAGAIN || e == EBUSY; }
+		// the ring is unusable, fails every pending request and sends new ones to the executor
+		void fail(const int& e){
+			kul::threading::ScopedLock<kul::FastMutex> lock(pm);
+			if(!ex) ex.reset(new kul::Executor(w));
+			f = 1;
+			for(std::promise<long>* p : ps){
+				p->set_exception(ERROR(e));
+				delete p;
+			}
+			ps.clear();
+			i = 0;
+		}
+		void reap(){
+			std::vector<std::pair<std::promise<long>*, int> > cs;
+			uint64_t u;
+			int res;
+			while(!f && (!s || i)){
+				// bounded so a ring failed by a submitter cannot leave this thread blocked
+				if(r->wait(1000) < 0){
+					if(errno == ETIME) continue;
+					if(TRANSIENT(errno)){
+						std::this_thread::yield();
+						continue;
+					}
+					return fail(errno);
+				}
+				cs.clear();
+				while(r->reap(u, res)) if(u) cs.push_back(std::make_pair((std::promise<long>*) u, res));
+				kul::threading::ScopedLock<kul::FastMutex> lock(pm);
+				for(const auto& c : cs){
+					if(!ps.erase(c.first)) continue;
+					if(c.second < 0) c.first->set_exception(ERROR(-c.second));
+					else c.first->set_value(c.second);
+					delete c.first;
+					i--;
+				}
+			}
+		}
+		// false when a request could not be sent, the ring has been failed
+		bool flush(){
+			while(r->pending()){
+				const int e = r->submit();
+				if(e > 0) continue;
+				if(e == 0 || TRANSIENT(errno)) return 1;
+				fail(errno);
+				return 0;
+			}
+			return 1;
+		}
+		std::future<long> ring(const unsigned char& op, const Descriptor& d, const void* b, const size_t& n, const uint64_t& o){
+			std::promise<long>* p = new std::promise<long>();
+			std::future<long> fu(p->get_future());
+			{
+				kul::threading::ScopedLock<kul::FastMutex> lock(m);
+				bool q = 0;
+				{
+					kul::threading::ScopedLock<kul::FastMutex> lock(pm);
+					if((q = !f)){
+						ps.insert(p);
+						i++;
+					}
+				}
+				if(q){
+					while(!r->prep(op, d, b, n > 0x7ffff000 ? 0x7ffff000 : n, o, (uint64_t) p)){
+						const int e = r->submit();
+						if(e > 0) continue;
+						if(e < 0 && !TRANSIENT(errno)){
+							fail(errno);
+							return fu;
+						}
+						std::this_thread::yield();
+					}
+					return fu;
+				}
+			}
+			delete p;
+			return pool(op == IORING_OP_WRITE, d, (char*) b, n, o);
+		}
+#endif
+		std::future<long> pool(const bool& wr, const Descriptor& d, char* b, const size_t& n, const uint64_t& o){
+			return ex->submit([=](){
+				const long res = wr ? PWRITE(d, b, n, o) : PREAD(d, b, n, o);
+				if(res < 0) KEXCEPT(Exception, "AsyncIO : request failed");
+				return res;
+			});
+		}
+	public:
+		AsyncIO(const unsigned& e = 256, const unsigned& w = kul::cpu::threads()) : w(w){
+#ifdef __linux__
+			s = 0;
+			f = 0;
+			i = 0;
+			r.reset(new Ring(e));
+			if(r->ok()){
+				t.reset(new kul::Thread([this](){ reap(); }));
+				t->name("kul.io.reaper");
+				t->run();
+				return;
+			}
+			r.reset();
+#else
+			(void) e;
+#endif
+			ex.reset(new kul::Executor(w));
+		}
+		~AsyncIO(){
+#ifdef __linux__
+			if(!r) return;
+			{
+				kul::threading::ScopedLock<kul::FastMutex> lock(m);
+				s = 1;
+				// wakes the reaper, if the ring has failed its wait fails as well
+				while(!r->prep(IORING_OP_NOP, -1, 0, 0, 0, 0)){
+					if(!flush()) break;
+					std::this_thread::yield();
+				}
+				while(r->pending() && flush()) std::this_thread::yield();
+			}
+			t->join();
+#endif
+		}
+		AsyncIO(const AsyncIO&) = delete;
+		AsyncIO& operator=(const AsyncIO&) = delete;
+		static AsyncIO& INSTANCE(){
+			static AsyncIO instance;
+			return instance;
+		}
+
+		std::future<long> read(const Descriptor& d, char* b, const size_t& n, const uint64_t& o){
+#ifdef __linux__
+			if(r) return ring(IORING_OP_READ, d, b, n, o);
+#endif
+			return pool(0, d, b, n, o);
+		}
+		std::future<long> write(const Descriptor& d, const char* b, const size_t& n, const uint64_t& o){
+#ifdef __linux__
+			if(r) return ring(IORING_OP_WRITE, d, b, n, o);
+#endif
+			return pool(1, d, (char*) b, n, o);
+		}
+		// sends queued ring requests to the kernel, requests on the fallback pool are already running
+		void submit(){
+#ifdef __linux__
+			if(!r) return;
+			kul::threading::ScopedLock<kul::FastMutex> lock(m);
+			if(!f) flush();
+#endif
+		}
+		bool uring() const {
+#ifdef __linux__
+			return r && !f;
+#else
+			return 0;
+#endif
+		}
+};
+
+}}
+#endif /* _KUL_IO_ASYNC_HPP_ */
@@ -34,9 +34,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <memory>
 #include <time.h>
 #include <fstream>
+#include <string.h>
+#include <functional>
 #include <stdexcept>
 
 #include "kul/os.hpp"
+#include "kul/io.os.hpp"
 #include "kul/except.hpp"
 #include "kul/string.hpp"
 
@@ -47,29 +50,117 @@ class Exception : public kul::Exception{
 		Exception(const char*f, const int l, const std::string& s) : kul::Exception(f, l, s){}
 };
 
+/**
+	Block buffer scanned for newlines with memchr, refilled through f(char*, size_t) -> bytes read.
+	Lines longer than the buffer grow it. Views are valid until the next call.
+*/
+class LineBuffer{
+	private:
+		bool e;
+		size_t b, c, s, z;
+		std::unique_ptr<char[]> v;
+		void grow(const size_t& n){
+			std::unique_ptr<char[]> g(new char[n]);
+			if(s) memcpy(g.get(), v.get(), s);
+			v = std::move(g);
+			z = n;
+		}
+		template <class F> void fill(F& f, const size_t& n){
+			if(!v) grow(z > n ? z : n);
+			if(b){
+				memmove(v.get(), v.get() + b, s - b);
+				c -= b; s -= b; b = 0;
+			}
+			if(z < n) grow(n);
+			else if(s == z) grow(z * 2);
+			const size_t r = f(v.get() + s, z - s);
+			if(!r) e = 1;
+			s += r;
+		}
+	public:
+		LineBuffer(const size_t& z = __KUL_IO_BUFFER__) : e(0), b(0), c(0), s(0), z(z){}
+		template <class F> bool line(StringView& l, F f){
+			while(1){
+				const char* p = s > c ? (const char*) memchr(v.get() + c, '\n', s - c) : 0;
+				if(p){
+					const size_t n = p - v.get();
+					l = StringView(v.get() + b, n - b);
+					b = c = n + 1;
+					return 1;
+				}
+				c = s;
+				if(e){
+					if(b == s) return 0;
+					l = StringView(v.get() + b, s - b);
+					b = c = s;
+					return 1;
+				}
+				fill(f, 0);
+			}
+		}
+		template <class F> bool read(StringView& l, const size_t& n, F f){
+			while(s - b < n && !e) fill(f, n);
+			const size_t r = s - b < n ? s - b : n;
+			l = StringView(v.get() + b, r);
+			b += r;
+			if(c < b) c = b;
+			return r;
+		}
+};
+
+/**
+	Range over the lines of a reader, for(const kul::StringView& l : reader.lines())
+	Each view is valid until the iterator advances.
+*/
+template <class R>
+class LineRange{
+	private:
+		R& r;
+	public:
+		class iterator{
+			private:
+				R* r;
+				StringView l;
+			public:
+				iterator(R* r) : r(r){ if(r) ++*this; }
+				iterator& operator++(){
+					if(!r->readLine(l)) r = 0;
+					return *this;
+				}
+				const StringView& operator*()			const { return l; }
+				bool operator!=(const iterator& i)	const { return r != i.r; }
+		};
+		LineRange(R& r) : r(r){}
+		iterator begin(){ return iterator(&r); }
+		iterator end(){ return iterator(0); }
+};
+
 class AReader{
 	private:
-		std::unique_ptr<std::string> str;
+		std::string str;
+		LineBuffer lb;
+		static size_t FILL(std::ifstream& f, char* b, const size_t& n){
+			f.read(b, n);
+			return f.gcount();
+		}
 	protected:
+		bool readLine(std::ifstream& f, StringView& l){
+			return lb.line(l, [&f](char* b, const size_t& n){ return FILL(f, b, n); });
+		}
+		bool readLine(std::ifstream& f, std::string& s){
+			StringView l;
+			if(!readLine(f, l)) return 0;
+			s.assign(l.data(), l.size());
+			return 1;
+		}
 		const std::string* readLine(std::ifstream& f){
-			str.reset();
-			if(f.good()){
-				std::string s;
-				std::getline(f, s);
-				str = std::make_unique<std::string>(s);
-			}
-			return str.get();
+			return readLine(f, str) ? &str : 0;
 		}
 		const std::string* read(std::ifstream& f, const uint& s){
-			str.reset();
-			if(f.good()){
-				std::vector<char> v;
-				v.resize(s);
-				f.read(&v[0], s);
-				v.resize(f.gcount());
-				str = std::make_unique<std::string>(std::string(v.begin(), v.end()));
-			}
-			return str.get();
+			StringView v;
+			if(!lb.read(v, s, [&f](char* b, const size_t& n){ return FILL(f, b, n); })) return 0;
+			str.assign(v.data(), v.size());
+			return &str;
 		}
 };
 class Reader : public AReader{
@@ -84,6 +175,15 @@ class Reader : public AReader{
 		const std::string* readLine(){
 			return AReader::readLine(f);
 		}
+		bool readLine(std::string& s){
+			return AReader::readLine(f, s);
+		}
+		bool readLine(StringView& l){
+			return AReader::readLine(f, l);
+		}
+		LineRange<Reader> lines(){
+			return LineRange<Reader>(*this);
+		}
 		const std::string* read(const uint& s){
 			return AReader::read(f, s);
 		}
@@ -100,11 +200,65 @@ class BinaryReader : public AReader{
 		const std::string* readLine(){
 			return AReader::readLine(f);
 		}
+		bool readLine(std::string& s){
+			return AReader::readLine(f, s);
+		}
+		bool readLine(StringView& l){
+			return AReader::readLine(f, l);
+		}
+		LineRange<BinaryReader> lines(){
+			return LineRange<BinaryReader>(*this);
+		}
 		const std::string* read(const uint& s){
 			return AReader::read(f, s);
 		}
 };
 
+/**
+	Reads a file through a read only memory map advised for sequential access.
+	Files which cannot be mapped (empty, pipes, procfs) are read with pread into a LineBuffer.
+	Views are valid for the life of the reader when mapped(), otherwise until the next read.
+*/
+class MappedReader{
+	private:
+		uint64_t o;
+		MemoryMap m;
+		LineBuffer lb;
+		std::function<size_t(char*, const size_t&)> f;
+	public:
+		MappedReader(const char* c) try : o(0), m(c), f([this](char* b, const size_t& n){
+				const long r = m.read(b, n, o);
+				if(r < 0) KEXCEPT(Exception, "FileException : file read failed");
+				o += r;
+				return (size_t) r;
+			}){
+			m.sequential();
+		}catch(const fs::Exception&){
+			KEXCEPT(Exception, "FileException : file \"" + std::string(c) + "\" not found");
+		}
+		MappedReader(const File& c) : MappedReader(c.full().c_str()){}
+		bool mapped() const { return m.data(); }
+		bool readLine(StringView& l){
+			if(!mapped()) return lb.line(l, f);
+			if(o >= m.size()) return 0;
+			const char* b = m.data() + o;
+			const char* p = (const char*) memchr(b, '\n', m.size() - o);
+			const size_t n = p ? p - b : m.size() - o;
+			l = StringView(b, n);
+			o += p ? n + 1 : n;
+			return 1;
+		}
+		LineRange<MappedReader> lines(){
+			return LineRange<MappedReader>(*this);
+		}
+		bool read(StringView& l, const size_t& s){
+			if(!mapped()) return lb.read(l, s, f);
+			const size_t n = m.size() - o < s ? m.size() - o : s;
+			l = StringView(m.data() + o, n);
+			o += n;
+			return n;
+		}
+};
 
 class AWriter{
 	protected:
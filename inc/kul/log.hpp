@@ -31,16 +31,33 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _KUL_LOG_HPP_
 #define _KUL_LOG_HPP_
 
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
+#include <fstream>
 #include <string.h>
+#include <algorithm>
+#include <condition_variable>
 
 #include "kul/os.hpp"
 #include "kul/def.hpp"
+#include "kul/io.os.hpp"
 #include "kul/time.hpp"
 #include "kul/except.hpp"
 #include "kul/string.hpp"
-#include "kul/threads.os.hpp"
+#include "kul/threads.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
 
 #ifndef __KUL_LOG_TIME_FRMT__
 #define __KUL_LOG_TIME_FRMT__ "%Y-%m-%d-%H:%M:%S:%i"
@@ -50,51 +67,498 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __KUL_LOG_FRMT__ "[%M] : %T - %D : %F : %L - %S"
 #endif
 
+#ifndef __KUL_LOG_MAX_LEVEL__
+#define __KUL_LOG_MAX_LEVEL__ 3
+#endif
+
+#ifndef __KUL_LOG_BIN_SIZE__
+#define __KUL_LOG_BIN_SIZE__ 8388608
+#endif
+
+#ifndef __KUL_LOG_ASYNC_BUFFER__
+#define __KUL_LOG_ASYNC_BUFFER__ 1024
+#endif
+
 namespace kul{ namespace log{
 
 enum mode { NON = 0, INF, ERR, DBG};
+enum backpressure { BLOCK = 0, DROP, COUNT};
 
 class Exception : public kul::Exception{
 	public:
 		Exception(const char*f, const int l, const std::string& s) : kul::Exception(f, l, s){}
 };
+
+class Record{
+	public:
+		std::chrono::system_clock::time_point t;
+		std::string ti, s;
+		const char* f = 0;
+		int l = 0;
+		mode m = NON;
+		bool raw = 0;
+};
+} // END NAMESPACE log
+
+namespace log{
+/**
+	Log format parsed once into literal and field segments,
+	see README for the meaning of each %field.
+*/
+class Format{
+	private:
+		class Segment{
+			public:
+				char c; // 0 for literal text
+				std::string s;
+				Segment(const char& c, const std::string& s) : c(c), s(s){}
+		};
+		std::vector<Segment> ss;
+	public:
+		Format(const std::string& f){
+			std::string l;
+			for(size_t i = 0; i < f.size(); i++){
+				if(f[i] == '%' && i + 1 < f.size() && strchr("MTDFLS", f[i + 1])){
+					if(l.size()) ss.push_back(Segment(0, l));
+					l.clear();
+					ss.push_back(Segment(f[++i], ""));
+				}else l += f[i];
+			}
+			if(l.size()) ss.push_back(Segment(0, l));
+		}
+		const std::vector<Segment>& segments() const { return ss; }
+};
+
+/**
+	Fixed buffer written straight to stdout or stderr with no locking or allocation,
+	so it can be used from signal handlers.
+*/
+class RawWriter{
+	private:
+		char* b;
+		const size_t z;
+		size_t n = 0;
+		int d = 1;
+	public:
+		RawWriter(char* b, const size_t& z) : b(b), z(z){}
+		~RawWriter(){ flush(); }
+		RawWriter(const RawWriter&) = delete;
+		RawWriter& operator=(const RawWriter&) = delete;
+		void to(const int& fd){
+			if(fd != d) flush();
+			d = fd;
+		}
+		void put(const char* c, size_t l){
+			while(l){
+				if(n == z) flush();
+				const size_t k = std::min(l, z - n);
+				memcpy(b + n, c, k);
+				n += k;
+				c += k;
+				l -= k;
+			}
+		}
+		void put(const char* c){ put(c, strlen(c)); }
+		void put(const long long& v){
+			char c[24];
+			size_t i = sizeof(c);
+			unsigned long long u = v < 0 ? 0 - (unsigned long long) v : v;
+			do{ c[--i] = '0' + u % 10; }while(u /= 10);
+			if(v < 0) c[--i] = '-';
+			put(c + i, sizeof(c) - i);
+		}
+		void flush(){
+			for(size_t o = 0; o < n; ){
+#ifdef _WIN32
+				const int w = _write(d, b + o, (unsigned int) (n - o));
+#else
+				const ssize_t w = ::write(d, b + o, n - o);
+				if(w < 0 && errno == EINTR) continue;
+#endif
+				if(w <= 0) break;
+				o += w;
+			}
+			n = 0;
+		}
+};
 } // END NAMESPACE log
 
 class Logger{
+	private:
+		const log::Format fr;
+		static void APPEND(std::string& b, const long& l){
+			char c[24];
+			const int n = snprintf(c, sizeof(c), "%ld", l);
+			if(n > 0) b.append(c, n);
+		}
+		void date(std::string& b, const std::chrono::system_clock::time_point& p) const{
+			static thread_local kul::time::Clock c(__KUL_LOG_TIME_FRMT__);
+			c.render(b, p);
+		}
 	public:
+		Logger() : fr(__KUL_LOG_FRMT__){}
 		void out(const std::string& s, const log::mode& m) const{
 			if(m != log::ERR) 
-				printf("%s", s.c_str());
+				fwrite(s.c_str(), 1, s.size(), stdout);
 			else
-				fprintf(stderr, "%s", s.c_str());
+				fwrite(s.c_str(), 1, s.size(), stderr);
+		}
+		void out(const std::vector<std::string>& ss, const size_t& n, const log::mode& m) const{
+			FILE* fi = m != log::ERR ? stdout : stderr;
+			fflush(fi);
+#ifdef _WIN32
+			for(size_t i = 0; i < n; i++) fwrite(ss[i].c_str(), 1, ss[i].size(), fi);
+			fflush(fi);
+#else
+			struct iovec v[IOV_MAX];
+			for(size_t i = 0; i < n; ){
+				size_t c = 0;
+				for(; c < IOV_MAX && i < n; c++, i++){
+					v[c].iov_base = const_cast<char*>(ss[i].c_str());
+					v[c].iov_len  = ss[i].size();
+				}
+				if(writev(fileno(fi), v, c) < 0) break;
+			}
+#endif
+		}
+		void format(std::string& b, const char* f, const int& l, const std::string& s, const log::mode& m,
+				const std::string& tr, const std::chrono::system_clock::time_point& t) const{
+			for(const auto& sg : fr.segments()){
+				switch(sg.c){
+					case 'M': b += modeTxt(m);	break;
+					case 'T': b += tr;			break;
+					case 'D': date(b, t);		break;
+					case 'F': b += f;			break;
+					case 'L': APPEND(b, l);		break;
+					case 'S': b += s;			break;
+					default : b += sg.s;
+				}
+			}
+			b += kul::os::EOL();
+		}
+		void format(std::string& b, const log::Record& r) const{
+			if(r.raw) b.append(r.s).append(kul::os::EOL());
+			else format(b, r.f, r.l, r.s, r.m, r.ti, r.t);
 		}
 		void log(const char* f, const int& l, const std::string& s, const log::mode& m) const{
-			std::string mode(modeTxt(m));
-			std::string tr(kul::this_thread::id());
-			std::string str(__KUL_LOG_FRMT__);
-			kul::String::replace(str, "%M", mode);
-			kul::String::replace(str, "%T", tr);
-			kul::String::replace(str, "%D", kul::DateTime::NOW(__KUL_LOG_TIME_FRMT__));
-			kul::String::replace(str, "%F", f);
-			kul::String::replace(str, "%L", std::to_string(l));
-			kul::String::replace(str, "%S", s);
-			str += kul::os::EOL();
-			out(str, m);
-		}
-		const std::string modeTxt(const log::mode& m) const{
-			std::string s("NON");
-			if(m == 1)		s = "INF";
-			else if(m == 2)	s = "ERR";
-			else if(m == 3) s = "DBG";
-			return s;
+			static thread_local std::string b;
+			b.clear();
+			format(b, f, l, s, m, kul::this_thread::name(), std::chrono::system_clock::now());
+			out(b, m);
+		}
+		/** async signal safe form of format(), %D is written as milliseconds since epoch */
+		void render(const log::Record& r, log::RawWriter& w) const{
+			w.to(r.m != log::ERR ? 1 : 2);
+			if(r.raw) w.put(r.s.data(), r.s.size());
+			else for(const auto& sg : fr.segments()){
+				switch(sg.c){
+					case 'M': w.put(modeTxt(r.m));	break;
+					case 'T': w.put(r.ti.data(), r.ti.size());	break;
+					case 'D': w.put((long long) std::chrono::duration_cast<std::chrono::milliseconds>(r.t.time_since_epoch()).count()); break;
+					case 'F': if(r.f) w.put(r.f);	break;
+					case 'L': w.put((long long) r.l);	break;
+					case 'S': w.put(r.s.data(), r.s.size());	break;
+					default : w.put(sg.s.data(), sg.s.size());
+				}
+			}
+			w.put(kul::os::EOL().data(), kul::os::EOL().size());
+		}
+		const char* modeTxt(const log::mode& m) const{
+			if(m == 1)		return "INF";
+			else if(m == 2)	return "ERR";
+			else if(m == 3) return "DBG";
+			return "NON";
+		}
+};
+
+namespace log{
+/**
+	Background log writer, producers push records into their own lock free queue
+	and a single thread formats them in batches, flushed with one writev per stream.
+	When a queue is full the backpressure policy decides to block or drop,
+	COUNT drops and reports the number lost with the next batch.
+*/
+class AsyncWriter{
+	private:
+		typedef kul::LockFreeQueue<Record> Queue;
+		bool p, st;
+		const backpressure bp;
+		std::atomic<uint64_t> d;
+		std::mutex m;
+		std::condition_variable cv;
+		kul::FastMutex qm, fm;
+		std::vector<std::shared_ptr<Queue> > qs;
+		std::vector<Record> rs;
+		std::vector<std::string> os, es;
+		std::unique_ptr<char[]> cb;
+		const uint64_t id;
+		const Logger& lg;
+		kul::Thread th;
+
+		// this thread's queue for this writer, keyed by id as writer addresses can be reused
+		Queue& local(){
+			static thread_local std::vector<std::pair<uint64_t, std::shared_ptr<Queue> > > tqs;
+			for(const auto& q : tqs) if(q.first == id) return *q.second;
+			// the writer has dropped queues it no longer holds, it is gone
+			tqs.erase(std::remove_if(tqs.begin(), tqs.end(),
+				[](const std::pair<uint64_t, std::shared_ptr<Queue> >& q){ return q.second.use_count() == 1; }), tqs.end());
+			std::shared_ptr<Queue> q(std::make_shared<Queue>(__KUL_LOG_ASYNC_BUFFER__));
+			{
+				kul::threading::ScopedLock<kul::FastMutex> lock(qm);
+				qs.push_back(q);
+			}
+			tqs.push_back(std::make_pair(id, q));
+			return *q;
 		}
+		static uint64_t ID(){
+			static std::atomic<uint64_t> i(0);
+			return ++i;
+		}
+		void wake(){
+			std::lock_guard<std::mutex> lock(m);
+			if(p) return;
+			p = 1;
+			cv.notify_one();
+		}
+		bool drain(){
+			kul::threading::ScopedLock<kul::FastMutex> lock(fm);
+			rs.clear();
+			{
+				kul::threading::ScopedLock<kul::FastMutex> lock(qm);
+				Record r;
+				for(const auto& q : qs) while(q->pop(r)) rs.push_back(std::move(r));
+				qs.erase(std::remove_if(qs.begin(), qs.end(),
+					[](const std::shared_ptr<Queue>& q){ return q.use_count() == 1 && q->empty(); }), qs.end());
+			}
+			const uint64_t dr = d.exchange(0);
+			if(rs.empty() && !dr) return false;
+			std::stable_sort(rs.begin(), rs.end(), [](const Record& a, const Record& b){ return a.t < b.t; });
+			size_t o = 0, e = 0;
+			for(const auto& r : rs){
+				std::vector<std::string>& v(r.m == ERR ? es : os);
+				size_t& i(r.m == ERR ? e : o);
+				if(v.size() == i) v.push_back(std::string());
+				v[i].clear();
+				lg.format(v[i++], r);
+			}
+			if(dr){
+				if(es.size() == e) es.push_back(std::string());
+				es[e++] = std::to_string(dr) + " LOG RECORDS DROPPED" + kul::os::EOL();
+			}
+			if(o) lg.out(os, o, INF);
+			if(e) lg.out(es, e, ERR);
+			return true;
+		}
+		void work(){
+			while(true){
+				{
+					std::unique_lock<std::mutex> lock(m);
+					cv.wait(lock, [this](){ return p || st; });
+					if(st) break;
+					p = 0;
+				}
+				drain();
+			}
+			while(drain()){}
+		}
+	public:
+		AsyncWriter(const Logger& lg, const backpressure& bp = BLOCK) : p(0), st(0), bp(bp), d(0), cb(new char[4096]), id(ID()), lg(lg), th([this](){ work(); }){
+			th.run();
+		}
+		~AsyncWriter(){
+			{
+				std::lock_guard<std::mutex> lock(m);
+				st = 1;
+			}
+			cv.notify_one();
+			th.join();
+		}
+		void push(Record&& r){
+			Queue& q = local();
+			while(!q.push(std::move(r))){
+				if(bp != BLOCK){
+					if(bp == COUNT) d++;
+					return;
+				}
+				wake();
+				std::this_thread::yield();
+			}
+			wake();
+		}
+		void flush(){
+			while(drain()){}
+		}
+		/**
+			For signal handlers, gives up if the writer, a registering producer or flush() holds a lock.
+			Pending records are written per thread in order, without sorting or allocating.
+		*/
+		void crash(){
+			if(!fm.tryLock()) return;
+			if(qm.tryLock()){
+				RawWriter w(cb.get(), 4096);
+				for(const auto& q : qs) while(q->consume([&](Record& r){ lg.render(r, w); })){}
+				qm.unlock();
+			}
+			fm.unlock();
+		}
+		uint64_t dropped() const { return d; }
 };
+} // END NAMESPACE log
+
+namespace log{
+/**
+	Binary log sink. Each call site (file, line, mode) is registered once in "<file>.sites"
+	as "id mode line file", records carry only the site id, timestamp, thread id and message
+	bytes in a ring buffer mapped from "<file>", overwriting the oldest records when full.
+	Use BinaryDecoder, or the "decode" profile, to turn a sink back into __KUL_LOG_FRMT__ text.
+*/
+class BinarySink{
+	private:
+		class Header{
+			public:
+				uint64_t m, c, h;
+		};
+		kul::FastMutex mu;
+		kul::io::MemoryMap mm;
+		Header* hd;
+		char* r;
+		uint32_t n;
+		std::ofstream sf;
+		std::map<std::tuple<const char*, int, int>, uint32_t> ss;
+
+		void put(uint64_t& o, const void* v, const size_t& l){
+			const char* b = (const char*) v;
+			for(size_t i = 0; i < l; ){
+				const size_t a = o % hd->c, k = std::min((size_t) (l - i), (size_t) (hd->c - a));
+				memcpy(r + a, b + i, k);
+				i += k;
+				o += k;
+			}
+		}
+		uint32_t site(const char* f, const int& l, const mode& m){
+			const auto k = std::make_tuple(f, l, (int) m);
+			auto it = ss.find(k);
+			if(it != ss.end()) return it->second;
+			sf << n << " " << m << " " << l << " " << f << std::endl;
+			ss.insert(std::make_pair(k, n));
+			return n++;
+		}
+	public:
+		static const uint64_t MAGIC = 0x4B554C42494E4C31; // KULBINL1
+		static const uint32_t SYNC  = 0x4B554C42;
+		static const size_t RECORD = 26; // sync, size, site, micros, thread length, message length
+
+		BinarySink(const std::string& f, const size_t& s = __KUL_LOG_BIN_SIZE__)
+				: mm(f, s + sizeof(Header)), hd((Header*) mm.data()), r(mm.data() + sizeof(Header)), n(0){
+			const bool re = hd->m == MAGIC && hd->c == s;
+			if(re){
+				std::ifstream in(f + ".sites");
+				std::string l;
+				while(std::getline(in, l)) if(l.size()) n++;
+			}else{
+				hd->m = MAGIC;
+				hd->c = s;
+				hd->h = 0;
+			}
+			sf.open(f + ".sites", re ? std::ios::out | std::ios::app : std::ios::out | std::ios::trunc);
+			if(!sf) KEXCEPT(Exception, "Cannot open \"" + f + ".sites\"");
+		}
+		~BinarySink(){
+			mm.sync();
+		}
+		void write(const char* f, const int& l, const mode& m, const std::string& ti, const std::string& s){
+			const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			const uint16_t tl = (uint16_t) std::min(ti.size(), (size_t) UINT16_MAX);
+			kul::threading::ScopedLock<kul::FastMutex> lock(mu);
+			const uint32_t ml = (uint32_t) std::min(s.size(), (size_t) (hd->c / 2));
+			const uint32_t sy = SYNC, sz = (uint32_t) (RECORD + tl + ml), id = site(f, l, m);
+			uint64_t o = hd->h;
+			put(o, &sy, 4);
+			put(o, &sz, 4);
+			put(o, &id, 4);
+			put(o, &us, 8);
+			put(o, &tl, 2);
+			put(o, &ml, 4);
+			put(o, ti.c_str(), tl);
+			put(o, s.c_str(), ml);
+			hd->h = o;
+		}
+};
+
+class BinaryDecoder{
+	private:
+		class Site{
+			public:
+				mode m;
+				int l;
+				std::string f;
+		};
+		const std::string p;
+		const Logger lg;
+	public:
+		BinaryDecoder(const std::string& p) : p(p){}
+		void decode(const std::function<void(const std::string&)>& fn) const{
+			std::map<uint32_t, Site> ss;
+			{
+				std::ifstream in(p + ".sites");
+				std::string li;
+				while(std::getline(in, li)){
+					std::stringstream st(li);
+					uint32_t id;
+					int m;
+					Site s;
+					if(!(st >> id >> m >> s.l)) continue;
+					std::getline(st >> std::ws, s.f);
+					s.m = (mode) m;
+					ss[id] = s;
+				}
+			}
+			const kul::io::MemoryMap mm(p);
+			if(!mm.data() || mm.size() < sizeof(uint64_t) * 3 || *(const uint64_t*) mm.data() != BinarySink::MAGIC)
+				KEXCEPT(Exception, "\"" + p + "\" is not a kul binary log");
+			const uint64_t c = ((const uint64_t*) mm.data())[1], h = ((const uint64_t*) mm.data())[2];
+			const char* r = mm.data() + sizeof(uint64_t) * 3;
+			auto get = [&](uint64_t o, void* v, const size_t& l){
+				for(size_t i = 0; i < l; i++, o++) ((char*) v)[i] = r[o % c];
+			};
+			std::string b, ti, s;
+			for(uint64_t o = h > c ? h - c : 0; o + BinarySink::RECORD <= h; ){
+				uint32_t sy, sz, id, ml;
+				int64_t us;
+				uint16_t tl;
+				get(o, &sy, 4);
+				get(o + 4, &sz, 4);
+				if(sy != BinarySink::SYNC || sz < BinarySink::RECORD || o + sz > h){ o++; continue; }
+				get(o + 8, &id, 4);
+				get(o + 12, &us, 8);
+				get(o + 20, &tl, 2);
+				get(o + 22, &ml, 4);
+				const auto it = ss.find(id);
+				if(it == ss.end() || BinarySink::RECORD + tl + ml != sz){ o++; continue; }
+				ti.resize(tl);
+				s.resize(ml);
+				if(tl) get(o + BinarySink::RECORD, &ti[0], tl);
+				if(ml) get(o + BinarySink::RECORD + tl, &s[0], ml);
+				b.clear();
+				lg.format(b, it->second.f.c_str(), it->second.l, s, it->second.m, ti,
+					std::chrono::system_clock::time_point(std::chrono::microseconds(us)));
+				fn(b);
+				o += sz;
+			}
+		}
+};
+} // END NAMESPACE log
 
 class LogMan{
 	private:
 		log::mode m;
 		const Logger logger;
-		LogMan() : m(kul::log::mode::NON), logger(){
+		kul::FastMutex am;
+		std::atomic<log::AsyncWriter*> aw;
+		std::unique_ptr<log::AsyncWriter> awo;
+		std::unique_ptr<log::BinarySink> bs;
+		LogMan() : m(kul::log::mode::NON), logger(), aw(0){
 			const char* klog = kul::env::GET("KLOG");
 			if(klog){
 				bool e = 0;
@@ -113,8 +577,26 @@ class LogMan{
 					out(m, "ERROR DISCERNING LOG LEVEL, ERROR LEVEL IN USE");
 				}
 			}
+#ifdef __KUL_LOG_ASYNC__
+			async();
+#endif
+		}
+		void push(log::AsyncWriter& w, const char* f, const int& l, const log::mode& m, const std::string& s, const bool& raw){
+			log::Record r;
+			r.t = std::chrono::system_clock::now();
+			if(!raw) r.ti = kul::this_thread::name();
+			r.f = f;
+			r.l = l;
+			r.m = m;
+			r.s = s;
+			r.raw = raw;
+			w.push(std::move(r));
 		}
 	public:
+		~LogMan(){
+			aw = 0;
+			awo.reset();
+		}
 		static LogMan& INSTANCE(){
 			static LogMan instance;
 			return instance;
@@ -122,14 +604,49 @@ class LogMan{
 		bool inf(){ return m >= log::INF;}
 		bool err(){ return m >= log::ERR;}
 		bool dbg(){ return m >= log::DBG;}
+		bool on(const log::mode& m) const { return this->m >= m;}
+		// switch to the background writer, records already written synchronously are not reordered
+		void async(const log::backpressure& bp = log::BLOCK){
+			if(aw.load(std::memory_order_acquire)) return;
+			kul::threading::ScopedLock<kul::FastMutex> lock(am);
+			if(awo) return;
+			awo = std::make_unique<log::AsyncWriter>(logger, bp);
+			aw.store(awo.get(), std::memory_order_release);
+		}
+		// send KLOG records to a binary sink instead of text, see log::BinarySink
+		void binary(const std::string& f, const size_t& s = __KUL_LOG_BIN_SIZE__){
+			if(!bs) bs = std::make_unique<log::BinarySink>(f, s);
+		}
+		void flush(){
+			if(log::AsyncWriter* w = aw.load(std::memory_order_acquire)) w->flush();
+			fflush(stdout);
+			fflush(stderr);
+		}
+		// async signal safe flush of the background writer, see log::AsyncWriter::crash
+		void crash(){
+			if(log::AsyncWriter* w = aw.load(std::memory_order_acquire)) w->crash();
+		}
+		uint64_t dropped() const {
+			const log::AsyncWriter* w = aw.load(std::memory_order_acquire);
+			return w ? w->dropped() : 0;
+		}
 		void log(const char* f, const int& l, const log::mode& m, const std::string& s){
-			if(this->m >= m) logger.log(f, l, s, m);
+			if(this->m >= m){
+				log::AsyncWriter* w = aw.load(std::memory_order_acquire);
+				if(bs) bs->write(f, l, m, kul::this_thread::name(), s);
+				else if(w) push(*w, f, l, m, s, 0);
+				else logger.log(f, l, s, m);
+			}
 		}
 		void out(const log::mode& m, const std::string& s){
-			if(this->m >= m) logger.out(s + kul::os::EOL(), m);
+			if(this->m >= m){
+				if(log::AsyncWriter* w = aw.load(std::memory_order_acquire)) push(*w, 0, 0, m, s, 1);
+				else logger.out(s + kul::os::EOL(), m);
+			}
 		}
 		void err(const log::mode& m, const std::string& s){
-			logger.out(s + kul::os::EOL(), m);
+			if(log::AsyncWriter* w = aw.load(std::memory_order_acquire)) push(*w, 0, 0, m, s, 1);
+			else logger.out(s + kul::os::EOL(), m);
 		}
 };
 
@@ -170,15 +687,19 @@ class ErrMessage : public Message{
 		ErrMessage() : Message(log::mode::ERR){}
 };
 
-#define KLOG_INF 	kul::LogMessage(__FILE__, __LINE__, kul::log::mode::INF)
-#define KLOG_ERR 	kul::LogMessage(__FILE__, __LINE__, kul::log::mode::ERR)
-#define KLOG_DBG 	kul::LogMessage(__FILE__, __LINE__, kul::log::mode::DBG)
+// Messages above __KUL_LOG_MAX_LEVEL__ are compiled out, otherwise the
+// stream arguments are only evaluated when the mode is enabled at runtime
+#define KLOG_IF(sev) if(__KUL_LOG_MAX_LEVEL__ < kul::log::mode::sev || !kul::LogMan::INSTANCE().on(kul::log::mode::sev)); else
+
+#define KLOG_INF 	KLOG_IF(INF) kul::LogMessage(__FILE__, __LINE__, kul::log::mode::INF)
+#define KLOG_ERR 	KLOG_IF(ERR) kul::LogMessage(__FILE__, __LINE__, kul::log::mode::ERR)
+#define KLOG_DBG 	KLOG_IF(DBG) kul::LogMessage(__FILE__, __LINE__, kul::log::mode::DBG)
 #define KLOG(sev) KLOG_ ## sev
 
 #define KOUT_NON 	kul::OutMessage()
-#define KOUT_INF 	kul::OutMessage(kul::log::mode::INF)
-#define KOUT_ERR 	kul::OutMessage(kul::log::mode::ERR)
-#define KOUT_DBG 	kul::OutMessage(kul::log::mode::DBG)
+#define KOUT_INF 	KLOG_IF(INF) kul::OutMessage(kul::log::mode::INF)
+#define KOUT_ERR 	KLOG_IF(ERR) kul::OutMessage(kul::log::mode::ERR)
+#define KOUT_DBG 	KLOG_IF(DBG) kul::OutMessage(kul::log::mode::DBG)
 #define KOUT(sev) KOUT_ ## sev
 
 #define KERR 		kul::ErrMessage()
@@ -37,6 +37,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "kul/os.os.hpp"
 #include "kul/except.hpp"
 #include "kul/string.hpp"
+#include "kul/threads.hpp"
 
 #include <fstream>
 #include <iostream>
@@ -55,11 +56,17 @@ class Exception : public kul::Exception{
 class TimeStamps{
 	private:
 		const uint a, c, m;
-		TimeStamps(const uint& a, const uint& c, const uint& m) : a(a), c(c), m(m){}
+		const Stat s;
+		TimeStamps(const Stat& s) : a(s.accessed() / 1000000000), c(s.changed() / 1000000000), m(s.modified() / 1000000000), s(s){}
 	public:
 		const uint& accessed() const { return a; }
-		const uint& created () const { return c; }
+		const uint& created () const { return c; } // inode change time on nix
 		const uint& modified() const { return m; }
+		// nanoseconds since the epoch
+		const int64_t& modifiedNanos()	const { return s.modified(); }
+		const int64_t& changedNanos()	const { return s.changed(); }
+		const uint64_t& inode()			const { return s.inode(); }
+		const uint64_t& size()			const { return s.size(); }
 		friend class kul::Dir;
 		friend class kul::File;
 };
@@ -117,9 +124,7 @@ class Dir : public fs::Item {
 		std::string p;
 
 		static const fs::TimeStamps TIMESTAMPS(const std::string& s){ 
-			uint a = 0, c = 0, m = 0;
-			fs::KulTimeStampsResolver::GET(s.c_str(), a, c, m);
-			return fs::TimeStamps(a, c, m);
+			return fs::TimeStamps(fs::Stat::AT(fs::Listing::NONE(), s.c_str()));
 		}
 		static const std::string LOCL(std::string s){
 #ifdef _WIN32
@@ -220,18 +225,12 @@ class Dir : public fs::Item {
 			}while(FindNextFile(hFind, &fdFile));
 			FindClose(hFind);
 #else
-			DIR *dir = opendir(real().c_str());
-			struct dirent *entry = readdir(dir);
-			while (entry != NULL){
-				std::string d(entry->d_name);
-				kul::Dir dd(JOIN(real(), entry->d_name));
-				if(d.compare(".") != 0 && d.compare("..") != 0
-					&& !(d.substr(0, 1).compare(".") == 0 && !incHidden)
-					&& dd.is())
-					dirs.push_back(dd);
-				entry = readdir(dir);
-			}
-			closedir(dir);
+			const std::string r(real());
+			const fs::Listing::Handle h = fs::Listing::OPEN(fs::Listing::NONE(), r.c_str());
+			fs::Listing::LIST(h, [&](const char* n, bool d){
+				if(d && (incHidden || n[0] != '.')) dirs.push_back(Dir(JOIN(r, n)));
+			});
+			fs::Listing::CLOSE(h);
 #endif
 			return dirs;
 		}
@@ -308,20 +307,13 @@ class File : public fs::Item {
 			return cp(kul::File(name(), d));
 		}
 		bool cp(const File& f) const{
-			std::ifstream src(d.join(n), std::ios::binary);
-			std::ofstream dst(f.dir().join(f.name()), std::ios::binary);
-			return (bool) (dst << src.rdbuf());
+			return fs::KulFileCopier::COPY(d.join(n).c_str(), f.dir().join(f.name()).c_str());
 		}
 #ifdef _WIN32
 		bool is() const{
-			return !name().empty() && (bool) std::ifstream(d.join(n).c_str());
-		}
-		bool rm() const{
-			if(is()){
-				unlink(d.join(n).c_str());
-				return true;
-			}
-			return false;
+			if(name().empty()) return false;
+			const DWORD a = GetFileAttributesA(d.join(n).c_str());
+			return a != INVALID_FILE_ATTRIBUTES && !(a & FILE_ATTRIBUTE_DIRECTORY);
 		}
 #else
 		bool is() const{
@@ -329,14 +321,10 @@ class File : public fs::Item {
 			struct stat buffer;
 			return (stat (d.join(n).c_str(), &buffer) == 0);
 		}
+#endif
 		bool rm() const{
-			if(is()){
-				remove(real().c_str());
-				return true;
-			}
-			return false;
+			return !name().empty() && fs::Listing::UNLINK(fs::Listing::NONE(), d.join(n).c_str(), 0);
 		}
-#endif
 		bool mk() const{
 			FILE* pFile;
 			pFile = fopen(full().c_str(),"w");
@@ -355,25 +343,10 @@ class File : public fs::Item {
 		const std::string real() const { return Dir::JOIN(d.real(), n); }
 		const std::string mini() const { return Dir::MINI(real()); }
 		const ulonglong   size() const{
-			ulonglong r = 0;
-#ifdef _WIN32
-			WIN32_FIND_DATA ffd;
-			HANDLE h = FindFirstFile(TEXT(mini().c_str()), &ffd);
-			if(h){
-				ULARGE_INTEGER ul;
-				ul.HighPart = ffd.nFileSizeHigh;
-				ul.LowPart = ffd.nFileSizeLow;
-				r = ul.QuadPart;
-				FindClose(h);
-			}
-#else
-			struct stat att;
-			if (stat(mini().c_str(), &att) != -1) r = att.st_size;
-#endif
-			return r; 
+			return fs::Stat::AT(fs::Listing::NONE(), full().c_str()).size();
 		}
 		const Dir& dir() const { return d; }
-		const fs::TimeStamps timeStamps() const { return Dir::TIMESTAMPS(mini()); }
+		const fs::TimeStamps timeStamps() const { return Dir::TIMESTAMPS(full()); }
 
 		File& operator=(const File& f) = default;
 		bool operator==(const File& f) const {
@@ -383,13 +356,76 @@ class File : public fs::Item {
 		explicit operator bool() const { return is(); }
 };
 
+namespace fs{
+class KulDirCopier{
+	private:
+		static void COPY(const Dir& s, const Dir& d, TaskGroup& g, std::atomic<bool>& ok){
+			d.mk();
+			for(const auto& f : s.files())
+				g.add([f, d, &ok](){ if(!f.cp(File(f.name(), d))) ok = 0; });
+			for(const auto& dd : s.dirs())
+				g.add([dd, d, &g, &ok](){ COPY(dd, Dir(dd.name(), d), g, ok); });
+		}
+		friend class kul::Dir;
+};
+
+/**
+	Deletes a tree with files unlinked relative to their directory's descriptor,
+	each subdirectory is a TaskGroup task and is removed once its last child is gone.
+	Links are removed, never followed.
+*/
+class KulDirRemover{
+	private:
+		class Node{
+			public:
+				const std::string p;
+				const std::shared_ptr<Node> pr;
+				std::atomic<size_t> c;
+				Node(const std::string& p, const std::shared_ptr<Node>& pr) : p(p), pr(pr), c(1){}
+		};
+		static void DONE(std::shared_ptr<Node> n, std::atomic<bool>& ok){
+			for(; n && --n->c == 0; n = n->pr)
+				if(!Listing::UNLINK(Listing::NONE(), n->p.c_str(), 1)) ok = 0;
+		}
+		static void TREE(const std::shared_ptr<Node>& n, TaskGroup& g, std::atomic<bool>& ok){
+			const Listing::Handle h = Listing::OPEN(Listing::NONE(), n->p.c_str());
+			if(!Listing::VALID(h)) ok = 0;
+			else{
+				Listing::LIST(h, [&](const char* c, bool d){
+					if(!d){
+						if(!Listing::UNLINK(h, c, 0)) ok = 0;
+						return;
+					}
+					std::shared_ptr<Node> cn(std::make_shared<Node>(Dir::JOIN(n->p, c), n));
+					n->c++;
+					g.add([cn, &g, &ok](){ TREE(cn, g, ok); });
+				}, 0);
+				Listing::CLOSE(h);
+			}
+			DONE(n, ok);
+		}
+	public:
+		static bool RM(const std::string& p, const unsigned int& t = kul::cpu::threads()){
+			std::atomic<bool> ok(1);
+			TaskGroup g(t);
+			TREE(std::make_shared<Node>(p, std::shared_ptr<Node>()), g, ok);
+			g.wait();
+			return ok;
+		}
+};
+} // END NAMESPACE fs
+
+inline void kul::Dir::rm() const{
+	if(is()) fs::KulDirRemover::RM(path());
+}
+
 inline bool kul::Dir::cp(const Dir& d) const{
 	if(!d.is() && !d.mk()) KEXCEPT(fs::Exception, "Directory: \"" + d.path() + "\" is not valid");
-	Dir c(d.join(name()));
-	c.mk();
-	for(const auto& f : files()) f.cp(c);
-	for(const auto& dd : dirs()) dd.cp(c);
-	return 1;
+	std::atomic<bool> ok(1);
+	TaskGroup g;
+	fs::KulDirCopier::COPY(*this, Dir(name(), d), g, ok);
+	g.wait();
+	return ok;
 }
 
 inline std::ostream& operator<<(std::ostream &s, const File& d){
@@ -427,12 +463,13 @@ inline const kul::Dir userDir(){
 inline const kul::Dir userAppDir(const std::string& app){
 	return kul::Dir(userDir().join(app));
 }
-inline const std::string EOL(){
+inline const std::string& EOL(){
 	#if (_MSC_VER >= 1800 )
-	return "\n";
+	static const std::string s("\n");
 	#else
-	return "\r\n";
+	static const std::string s("\r\n");
 	#endif
+	return s;
 }
 } // END NAMESPACE os
 #else
@@ -452,8 +489,9 @@ inline const kul::Dir userDir(){
 inline const kul::Dir userAppDir(const std::string& app){
 	return Dir(Dir::JOIN(env::GET("HOME"), "." + app));
 }
-inline const std::string EOL(){
-	return "\n";
+inline const std::string& EOL(){
+	static const std::string s("\n");
+	return s;
 }
 } // END NAMESPACE os
 #endif
@@ -467,13 +505,6 @@ inline bool kul::env::CWD(const std::string& c){
 inline bool kul::env::CWD(const kul::Dir& d){
 	return _chdir(d.path().c_str());
 }
-inline void kul::Dir::rm() const{
-	if(is()){
-		for(const auto& a : files()) a.rm();
-		for(const auto& a : dirs())  a.rm();
-		_rmdir(path().c_str());
-	}
-}
 inline const std::vector<kul::File> kul::Dir::files(bool recursive) const throw(fs::Exception){
 	if(!is()) KEXCEPT(fs::Exception, "Directory : \"" + path() + "\" does not exist");
 
@@ -510,25 +541,15 @@ inline bool kul::env::CWD(const std::string& c){
 inline bool kul::env::CWD(const kul::Dir& d){
 	return chdir(d.path().c_str());
 }
-inline void kul::Dir::rm() const{
-	if(is()){
-		for(const auto& a : files()) a.rm();
-		for(const auto& a : dirs())  a.rm();
-		remove(real().c_str());
-	}
-}
 inline const std::vector<kul::File> kul::Dir::files(bool recursive) const throw(fs::Exception){
 	if(!is()) KEXCEPT(fs::Exception, "Directory : \"" + path() + "\" does not exist");
 
 	std::vector<File> fs;
-	DIR *dir = opendir(path().c_str());
-	struct dirent *entry = readdir(dir);
-	while (entry != NULL){
-		if(!kul::Dir(JOIN(real(), entry->d_name)).is())
-			fs.push_back(File(entry->d_name, *this));
-		entry = readdir(dir);
-	}
-	closedir(dir);
+	const kul::fs::Listing::Handle h = kul::fs::Listing::OPEN(kul::fs::Listing::NONE(), path().c_str());
+	kul::fs::Listing::LIST(h, [&](const char* n, bool d){
+		if(!d) fs.push_back(File(n, *this));
+	});
+	kul::fs::Listing::CLOSE(h);
 	if(recursive){
 		for(const kul::Dir& d : dirs()){
 			const std::vector<kul::File>& tFs = d.files(true);
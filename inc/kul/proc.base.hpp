@@ -31,13 +31,18 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _KUL_PROC_BASE_HPP_
 #define _KUL_PROC_BASE_HPP_
 
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <sstream>
 #include <iostream>
+#include <string.h>
+#include <algorithm>
 #include <functional>
 
 #include "kul/hash.hpp"
 #include "kul/except.hpp"
+#include "kul/string.hpp"
 
 namespace kul { 
 
@@ -46,6 +51,8 @@ namespace this_proc{
 	void kill(const int& e);
 }
 
+class Process;
+
 namespace proc{
 
 class Exception : public kul::Exception{
@@ -62,6 +69,94 @@ class ExitException : public kul::proc::Exception{
 };
 
 
+/**
+	Resources used by an exited child, cpu and wall times in nanoseconds, peak resident set in bytes.
+	Context switches are not available on windows.
+*/
+class Usage{
+	private:
+		uint64_t u = 0, s = 0, r = 0, mn = 0, mj = 0, v = 0, iv = 0;
+		int64_t b = 0, e = 0;
+		friend class kul::Process;
+		static int64_t NOW(){
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		}
+	public:
+		const uint64_t& user()					const { return u; }
+		const uint64_t& system()				const { return s; }
+		const uint64_t& maxRSS()				const { return r; }
+		const uint64_t& minorFaults()			const { return mn; }
+		const uint64_t& majorFaults()			const { return mj; }
+		const uint64_t& voluntarySwitches()		const { return v; }
+		const uint64_t& involuntarySwitches()	const { return iv; }
+		/** wall clock, nanoseconds since epoch */
+		const int64_t& start()					const { return b; }
+		const int64_t& end()					const { return e; }
+		int64_t wall()							const { return e - b; }
+		/** sums counters and cpu times, keeps the largest peak and spans both wall times */
+		Usage& operator+=(const Usage& o){
+			u += o.u;
+			s += o.s;
+			r = std::max(r, o.r);
+			mn += o.mn;
+			mj += o.mj;
+			v += o.v;
+			iv += o.iv;
+			b = b && o.b ? std::min(b, o.b) : std::max(b, o.b);
+			e = std::max(e, o.e);
+			return *this;
+		}
+};
+
+/**
+	Bytes appended into fixed size pages which are never moved or reallocated,
+	views() stay valid until clear() though the last may since have grown.
+*/
+class Chunks{
+	private:
+		size_t z, n = 0;
+		std::vector<std::unique_ptr<char[]> > ps;
+	public:
+		Chunks(const size_t& z = 4096) : z(z ? z : 1){}
+		Chunks(const Chunks& c) : z(c.z){
+			for(const StringView& v : c.views()) append(v.data(), v.size());
+		}
+		Chunks& operator=(const Chunks& c){
+			if(this == &c) return *this;
+			clear();
+			for(const StringView& v : c.views()) append(v.data(), v.size());
+			return *this;
+		}
+		void append(const char* c, size_t s){
+			while(s){
+				if(n == ps.size() * z) ps.emplace_back(new char[z]);
+				const size_t o = n % z, w = std::min(s, z - o);
+				memcpy(ps.back().get() + o, c, w);
+				n += w;
+				c += w;
+				s -= w;
+			}
+		}
+		void clear(){
+			ps.clear();
+			n = 0;
+		}
+		const size_t& size() const { return n; }
+		bool empty() const { return n == 0; }
+		std::vector<StringView> views() const {
+			std::vector<StringView> vs;
+			vs.reserve(ps.size());
+			for(size_t i = 0; i < ps.size(); i++) vs.emplace_back(ps[i].get(), std::min(z, n - i * z));
+			return vs;
+		}
+		std::string str() const {
+			std::string s;
+			s.reserve(n);
+			for(const StringView& v : views()) s.append(v.data(), v.size());
+			return s;
+		}
+};
+
 class Call{
 	private:
 		std::string cwd;
@@ -106,8 +201,11 @@ class AProcess{
 		const std::string d;
 		std::function<void(std::string)> e;
 		std::function<void(std::string)> o;
+		std::function<void(const char*, size_t)> eb;
+		std::function<void(const char*, size_t)> ob;
 		std::vector<std::string> argv;
 		kul::hash::map::S2S evs;
+		proc::Usage pu;
 		friend std::ostream& operator<<(std::ostream&, const AProcess&);
 	protected:
 		AProcess(const std::string& cmd, const bool& wfe) : wfe(wfe){ argv.push_back(cmd); }
@@ -134,11 +232,31 @@ class AProcess{
 			if(this->e) this->e(s);
 			else 		fprintf(stderr, "%s", s.c_str());
 		}
+		/** raw child output as read, only copied for std::string callbacks or overrides */
+		virtual void out(const char* c, const size_t& n){
+			if(this->ob) this->ob(c, n);
+			else 		 out(std::string(c, n));
+		}
+		virtual void err(const char* c, const size_t& n){
+			if(this->eb) this->eb(c, n);
+			else 		 err(std::string(c, n));
+		}
 		void error(const int line, std::string s) throw (kul::Exception){
 			tearDown();
-			throw Exception("kul/proc.hpp", line, s);
+			throw proc::Exception("kul/proc.hpp", line, s);
 		}
 		void exitCode(const int& e){ pec = e; }
+		void usage(const proc::Usage& u){ pu = u; }
+		void starting() throw(kul::Exception){
+			if(this->s) KEXCEPT(kul::proc::Exception, "Process is already started");
+			this->s = true;
+		}
+		void exited() const throw(kul::proc::ExitException){
+			if(pec != 0)
+				kul::LogMan::INSTANCE().err()
+					? throw proc::ExitException(__FILE__, __LINE__, pec, "Process exit code: " + std::to_string(pec) + kul::os::EOL() + toString())
+					: throw proc::ExitException(__FILE__, __LINE__, pec, "Process exit code: " + std::to_string(pec));
+		}
 	public:
 		template <class T> AProcess& arg(const T& a) { 
 			std::stringstream ss;
@@ -149,14 +267,10 @@ class AProcess{
 		AProcess& arg(const std::string& a) { if(a.size()) argv.push_back(a); return *this; }
 		AProcess& var(const std::string& n, const std::string& v) { evs.insert(n, v); return *this;}
 		virtual void start() throw(kul::Exception){
-			if(this->s) KEXCEPT(kul::proc::Exception, "Process is already started");
-			this->s = true;
-			if(this->o || this->e) this->run();
+			starting();
+			if(this->o || this->e || this->ob || this->eb) this->run();
 			else pec = proc::Call(toString(), evs, d).run();
-			if(pec != 0)
-				kul::LogMan::INSTANCE().err()
-					? throw proc::ExitException(__FILE__, __LINE__, pec, "Process exit code: " + std::to_string(pec) + kul::os::EOL() + toString())
-					: throw proc::ExitException(__FILE__, __LINE__, pec, "Process exit code: " + std::to_string(pec));
+			exited();
 		}
 		const unsigned int& pid() 	const { return pi; }
 		bool started()		const { return pi > 0; }
@@ -169,25 +283,44 @@ class AProcess{
 		}
 		void setOut(std::function<void(std::string)> o) { this->o = o; }
 		void setErr(std::function<void(std::string)> e) { this->e = e; }
+		/** c is only valid for the duration of the call */
+		void setOutBuffer(std::function<void(const char*, size_t)> o) { this->ob = o; }
+		void setErrBuffer(std::function<void(const char*, size_t)> e) { this->eb = e; }
 		const int& exitCode(){ return pec; }
+		/** filled once a process run with output callbacks, or in a ProcessGroup, has exited */
+		const proc::Usage& usage() const { return pu; }
 };
 
 inline std::ostream& operator<<(std::ostream &s, const AProcess &p){
 	return s << p.toString();
 }
 
+/**
+	Captures output into pages without copying. Subclasses overriding the string
+	out/err must call strings() so chunks reach them, which costs one copy per read.
+*/
 class ProcessCapture{
 	private:
-		std::stringstream so;
-		std::stringstream se;
+		bool sv = 0;
+		proc::Chunks so;
+		proc::Chunks se;
 	protected:
 		ProcessCapture(){}
-		ProcessCapture(const ProcessCapture& pc) : so(pc.so.str()), se(pc.se.str()){}
+		ProcessCapture(const ProcessCapture& pc) : sv(pc.sv), so(pc.so), se(pc.se){}
+		void strings(){ sv = 1; }
 		virtual void out(const std::string& s){
-			so << s;
+			so.append(s.data(), s.size());
 		}
 		virtual void err(const std::string& s){
-			se << s;
+			se.append(s.data(), s.size());
+		}
+		virtual void out(const char* c, const size_t& n){
+			if(sv) out(std::string(c, n));
+			else  so.append(c, n);
+		}
+		virtual void err(const char* c, const size_t& n){
+			if(sv) err(std::string(c, n));
+			else  se.append(c, n);
 		}
 	public:
 		ProcessCapture(AProcess& p){
@@ -196,9 +329,12 @@ class ProcessCapture{
 		virtual ~ProcessCapture(){}
 		const std::string outs() const { return so.str(); }
 		const std::string errs() const { return se.str(); }
+		/** output in order without copying, valid while this capture is */
+		std::vector<StringView> outv() const { return so.views(); }
+		std::vector<StringView> errv() const { return se.views(); }
 		void setProcess(AProcess& p){
-			p.setOut(std::bind(&ProcessCapture::out, std::ref(*this), std::placeholders::_1));
-			p.setErr(std::bind(&ProcessCapture::err, std::ref(*this), std::placeholders::_1));
+			p.setOutBuffer([this](const char* c, size_t n){ out(c, n); });
+			p.setErrBuffer([this](const char* c, size_t n){ err(c, n); });
 		}
 };
 
@@ -35,6 +35,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <string.h>
 
 namespace kul { 
 
@@ -110,5 +111,32 @@ class String{
 		}
 };
 
+/**
+	Non owning view of a character range, valid only while its source is.
+*/
+class StringView{
+	private:
+		const char* d;
+		size_t s;
+	public:
+		StringView() : d(0), s(0){}
+		StringView(const char* d, const size_t& s) : d(d), s(s){}
+		StringView(const std::string& str) : d(str.data()), s(str.size()){}
+		const char* data()					const { return d; }
+		const size_t& size()				const { return s; }
+		bool empty()						const { return s == 0; }
+		const char* begin()					const { return d; }
+		const char* end()					const { return d + s; }
+		const char& operator[](const size_t& i)	const { return d[i]; }
+		std::string str()					const { return std::string(d, s); }
+		bool operator==(const StringView& v) const {
+			return s == v.s && (s == 0 || memcmp(d, v.d, s) == 0);
+		}
+		bool operator!=(const StringView& v) const { return !(*this == v); }
+};
+inline std::ostream& operator<<(std::ostream& o, const StringView& v){
+	return o.write(v.data(), v.size());
+}
+
 }
 #endif /* _KUL_STRING_HPP_ */
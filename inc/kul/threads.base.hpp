@@ -66,6 +66,7 @@ class ThreadObject{
 	private:		
 		virtual void act() = 0;
 		friend class AThread;
+		friend class kul::ThreadPool;
 	public:
 		virtual ~ThreadObject(){}
 };
@@ -90,6 +91,7 @@ namespace threading{
 class AThread{
 	protected:
 		std::atomic<bool> f, s;
+		std::string n;
 		std::exception_ptr ep;
 		std::shared_ptr<threading::ThreadObject> to;
 
@@ -111,6 +113,7 @@ class AThread{
 		bool started() { return s; }
 		bool finished(){ return f; }
 		const std::exception_ptr& exception(){ return ep;}
+		void name(const std::string& n){ this->n = n; } // applied to the thread on run
 		void rethrow(){ if(ep) std::rethrow_exception(ep);}
 };
 
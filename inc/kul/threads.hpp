@@ -31,10 +31,49 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _KUL_THREADS_HPP_
 #define _KUL_THREADS_HPP_
 
+#include <deque>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <condition_variable>
+
+#include "kul/cpu.hpp"
 #include "kul/threads.os.hpp"
+#include "kul/threads.queue.hpp"
 
 namespace kul{
 
+namespace threading{
+class ExclusiveLock{
+	public:
+		template <class M> static void lock(M& m)	{ m.lock(); }
+		template <class M> static void unlock(M& m)	{ m.unlock(); }
+};
+class SharedLock{
+	public:
+		template <class M> static void lock(M& m)	{ m.lockShared(); }
+		template <class M> static void unlock(M& m)	{ m.unlockShared(); }
+};
+/**
+	Lock guard for any mutex type with the lock policy fixed at compile time.
+	ScopeLock guards kul::Mutex and ScopeReadLock the shared side of kul::SharedMutex.
+*/
+template <class M, class P = ExclusiveLock>
+class ScopedLock{
+	private:
+		M& m;
+	public:
+		ScopedLock(M& m) : m(m) {
+			P::lock(this->m);
+		}
+		~ScopedLock(){
+			P::unlock(this->m);
+		}
+		ScopedLock(const ScopedLock&) = delete;
+		ScopedLock& operator=(const ScopedLock&) = delete;
+};
+} // END NAMESPACE threading
+
 class ScopeLock{
 	private:
 		Mutex& m;
@@ -46,63 +85,318 @@ class ScopeLock{
 			this->m.unlock();
 		}
 };
+class ScopeReadLock : public threading::ScopedLock<SharedMutex, threading::SharedLock>{
+	public:
+		ScopeReadLock(SharedMutex& m) : threading::ScopedLock<SharedMutex, threading::SharedLock>(m){}
+};
+
+namespace threading{
+class TaskDeque{
+	private:
+		std::mutex m;
+		std::deque<std::function<void()> > q;
+	public:
+		void push(std::function<void()>&& f){
+			std::lock_guard<std::mutex> l(m);
+			q.push_back(std::move(f));
+		}
+		bool pop(std::function<void()>& f){
+			std::lock_guard<std::mutex> l(m);
+			if(q.empty()) return false;
+			f = std::move(q.back());
+			q.pop_back();
+			return true;
+		}
+		bool steal(std::function<void()>& f){
+			std::lock_guard<std::mutex> l(m);
+			if(q.empty()) return false;
+			f = std::move(q.front());
+			q.pop_front();
+			return true;
+		}
+};
+} // END NAMESPACE threading
+
+/**
+	Persistent work stealing executor, worker threads are created once and live until destruction.
+	Each worker owns a deque, it pops its own work LIFO and steals from the others FIFO when empty.
+	Tasks submitted from a worker go to that worker's deque, others are distributed round robin.
+	Blocking on a future from within a task can starve the executor, submit continuations instead.
+*/
+class Executor{
+	private:
+		bool stop;
+		std::atomic<size_t> p, r;
+		std::mutex m;
+		std::condition_variable cv;
+		std::vector<std::unique_ptr<threading::TaskDeque> > qs;
+		std::vector<std::shared_ptr<kul::Thread> > ts;
+
+		static const Executor*& OWNER(){ static thread_local const Executor* e = 0; return e; }
+		static size_t& INDEX(){ static thread_local size_t i = 0; return i; }
+
+		bool take(const size_t& i, std::function<void()>& f){
+			bool t = qs[i]->pop(f);
+			for(size_t j = 1; !t && j < qs.size(); j++) t = qs[(i + j) % qs.size()]->steal(f);
+			if(t) p--;
+			return t;
+		}
+		void work(const size_t& i){
+			OWNER() = this;
+			INDEX() = i;
+			this_thread::name("kul.worker." + std::to_string(i));
+			std::function<void()> f;
+			while(true){
+				if(take(i, f)){
+					f();
+					f = nullptr;
+					continue;
+				}
+				std::unique_lock<std::mutex> l(m);
+				cv.wait(l, [this](){ return stop || p > 0; });
+				if(stop && p == 0) return;
+			}
+		}
+		void push(std::function<void()>&& f){
+			p++;
+			qs[OWNER() == this ? INDEX() : r++ % qs.size()]->push(std::move(f));
+			{ std::lock_guard<std::mutex> l(m); }
+			cv.notify_one();
+		}
+	public:
+		Executor(const unsigned int& n = kul::cpu::threads()) : stop(0), p(0), r(0){
+			const unsigned int w = n ? n : 1;
+			for(unsigned int i = 0; i < w; i++) qs.push_back(std::unique_ptr<threading::TaskDeque>(new threading::TaskDeque()));
+			for(unsigned int i = 0; i < w; i++){
+				std::shared_ptr<kul::Thread> t = std::make_shared<kul::Thread>([this, i](){ work(i); });
+				t->run();
+				ts.push_back(t);
+				this_thread::nSleep(__KUL_THREAD_SPAWN_WAIT__);
+			}
+		}
+		~Executor(){
+			{
+				std::lock_guard<std::mutex> l(m);
+				stop = 1;
+			}
+			cv.notify_all();
+			for(const auto& t : ts) t->join();
+		}
+		static Executor& INSTANCE(){
+			static Executor instance;
+			return instance;
+		}
+		template <class F> std::future<typename std::result_of<F()>::type> submit(F f){
+			typedef typename std::result_of<F()>::type R;
+			std::shared_ptr<std::packaged_task<R()> > t = std::make_shared<std::packaged_task<R()> >(std::move(f));
+			std::future<R> fu(t->get_future());
+			push([t](){ (*t)(); });
+			return fu;
+		}
+		size_t workers() const { return ts.size(); }
+};
+
+/**
+	Tasks run on the Executor with at most m in flight, tasks may add() further tasks.
+	The thread in wait() runs queued tasks itself, so groups can be waited on from Executor workers.
+	wait() rethrows the first exception raised by a task once all tasks have finished.
+*/
+class TaskGroup{
+	private:
+		class State{
+			public:
+				size_t r = 0, h = 0;
+				std::mutex m;
+				std::condition_variable cv;
+				std::exception_ptr e;
+				std::deque<std::function<void()> > q;
+				// runs queued tasks until none are left, with the lock held on entry and exit
+				void drain(std::unique_lock<std::mutex>& l){
+					while(!q.empty()){
+						std::function<void()> f(std::move(q.front()));
+						q.pop_front();
+						r++;
+						l.unlock();
+						try{
+							f();
+						}catch(...){
+							l.lock();
+							if(!e) e = std::current_exception();
+							l.unlock();
+						}
+						l.lock();
+						r--;
+					}
+					cv.notify_all();
+				}
+		};
+		const unsigned int m;
+		std::shared_ptr<State> s;
+	public:
+		TaskGroup(const unsigned int& m = kul::cpu::threads()) : m(m ? m : 1), s(std::make_shared<State>()){}
+		~TaskGroup(){
+			try{ wait(); }catch(...){}
+		}
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+		void add(std::function<void()>&& f){
+			std::lock_guard<std::mutex> l(s->m);
+			s->q.push_back(std::move(f));
+			if(s->h + 1 < m){
+				s->h++;
+				std::shared_ptr<State> st(s);
+				Executor::INSTANCE().submit([st](){
+					std::unique_lock<std::mutex> l(st->m);
+					st->drain(l);
+					st->h--;
+				});
+			}
+			s->cv.notify_all();
+		}
+		void wait(){
+			std::unique_lock<std::mutex> l(s->m);
+			while(true){
+				s->drain(l);
+				if(s->r == 0) break;
+				s->cv.wait(l, [this](){ return !s->q.empty() || s->r == 0; });
+			}
+			if(s->e){
+				std::exception_ptr e(s->e);
+				s->e = nullptr;
+				std::rethrow_exception(e);
+			}
+		}
+};
 
+namespace threading{
+class TaskTime{
+	private:
+		int64_t w, r;
+	public:
+		TaskTime(const int64_t& w, const int64_t& r) : w(w), r(r){}
+		const int64_t& waited() const { return w; } // nanoseconds from pool start until the task began
+		const int64_t& ran()	const { return r; } // nanoseconds spent inside the task
+};
+} // END NAMESPACE threading
+
+/**
+	Runs the object n times with at most m runs in flight, on Executor workers
+	and on dedicated threads for any beyond Executor::workers().
+	The thread in join() runs pending work itself, so pools may join pools from within tasks.
+	Destroying a pool blocks until every run has finished unless detach() was called,
+	detached runs continue after the pool is gone.
+*/
 class ThreadPool{
 	protected:
+		class State{
+			public:
+				unsigned int m, n = 0, a = 0, f = 0;
+				std::atomic<unsigned int> c;
+				std::chrono::steady_clock::time_point b;
+				std::mutex cm;
+				std::condition_variable cv;
+				kul::FastMutex mu;
+				std::shared_ptr<kul::threading::ThreadObject> to;
+				std::vector<std::exception_ptr> ePs;
+				std::vector<threading::TaskTime> tts;
+				State(const std::shared_ptr<kul::threading::ThreadObject>& to) : m(1), c(0), to(to){}
+				void drain(){
+					{
+						std::lock_guard<std::mutex> lock(cm);
+						if(a >= m || c >= n) return;
+						a++;
+					}
+					while(c++ < n){
+						const auto st = std::chrono::steady_clock::now();
+						try{
+							to->act();
+						}catch(...){
+							kul::threading::ScopedLock<kul::FastMutex> lock(mu);
+							ePs.push_back(std::current_exception());
+						}
+						const auto fi = std::chrono::steady_clock::now();
+						{
+							kul::threading::ScopedLock<kul::FastMutex> lock(mu);
+							tts.push_back(threading::TaskTime(
+								std::chrono::duration_cast<std::chrono::nanoseconds>(st - b).count(),
+								std::chrono::duration_cast<std::chrono::nanoseconds>(fi - st).count()));
+						}
+						std::lock_guard<std::mutex> lock(cm);
+						f++;
+					}
+					std::lock_guard<std::mutex> lock(cm);
+					a--;
+					cv.notify_all();
+				}
+		};
 		bool d, s;
-		unsigned int m;	
-		kul::Ref<ThreadPool> re;
-		kul::Thread th;
-		std::shared_ptr<kul::threading::ThreadObject> to;
+		std::shared_ptr<State> st;
 		std::vector<std::shared_ptr<kul::Thread> > ts;
-		std::vector<std::exception_ptr> ePs;
 		void setStarted()	{ s = true; }
 		bool started()		{ return s; }
-		virtual void start() throw (std::exception) {
-			if(started()) KEXCEPT(Exception, "ThreadPool is already started");
-			setStarted();
-			for(unsigned int i = 0 ; i < m; i++){
-				std::shared_ptr<kul::Thread> at = std::make_shared<kul::Thread>(to);
+		void launch(const unsigned int& t){
+			st->n = t;
+			st->b = std::chrono::steady_clock::now();
+			std::shared_ptr<State> sp(st);
+			for(unsigned int l = 0; l < st->m && l < t; l++){
+				if(l < Executor::INSTANCE().workers()){
+					Executor::INSTANCE().submit([sp](){ sp->drain(); });
+					continue;
+				}
+				std::shared_ptr<kul::Thread> at = std::make_shared<kul::Thread>([sp](){ sp->drain(); });
 				at->run();
 				ts.push_back(at);
 				this_thread::nSleep(__KUL_THREAD_SPAWN_WAIT__);
 			}
 		}
+		void wait(){
+			st->drain();
+			{
+				std::unique_lock<std::mutex> lock(st->cm);
+				st->cv.wait(lock, [this](){ return st->f >= st->n; });
+			}
+			for(const auto& t : ts) t->join();
+			ts.clear();
+		}
+		virtual void start() throw (std::exception) {
+			if(started()) KEXCEPT(Exception, "ThreadPool is already started");
+			setStarted();
+			launch(st->m);
+		}
 	public:
-		template <class T> ThreadPool(const T& t) 			: d(0), s(0), m(1), re(*this), th(re), to(std::make_shared<kul::ThreadCopy<T> >(t)){}
-		template <class T> ThreadPool(const Ref<T>& ref) 	: d(0), s(0), m(1), re(*this), th(re), to(std::make_shared<kul::ThreadRef<T> >(ref)){}
-		void setMax(const int& max) { m = max;}
+		template <class T> ThreadPool(const T& t) 			: d(0), s(0), st(std::make_shared<State>(std::make_shared<kul::ThreadCopy<T> >(t))){}
+		template <class T> ThreadPool(const Ref<T>& ref) 	: d(0), s(0), st(std::make_shared<State>(std::make_shared<kul::ThreadRef<T> >(ref))){}
+		virtual ~ThreadPool(){
+			if(!d) wait();
+			// runs hold the state, only the dedicated threads need an owner until they finish
+			else if(ts.size()){
+				std::vector<std::shared_ptr<kul::Thread> > dts(std::move(ts));
+				Executor::INSTANCE().submit([dts](){ for(const auto& t : dts) t->join(); });
+			}
+		}
+		void setMax(const int& max) { st->m = max > 0 ? max : 1;}
 		void run(){
-			th.run();
+			start();
 		}
 		void operator()(){
 			start();
 		}
 		virtual void join() throw (std::exception){
-			th.join();
-			while(ts.size()){
-				const std::shared_ptr<kul::Thread>* del = 0;
-				for(const auto& t : ts){
-					if(t->finished()){
-						t->join();
-						if(t->exception() != std::exception_ptr()){
-							if(!d) std::rethrow_exception(t->exception());
-							ePs.push_back(t->exception());
-						}
-						del = &t; break;
-					}
-				}
-				this_thread::sleep(11);
-				if(del) ts.erase(std::remove(ts.begin(), ts.end(), *del), ts.end());
-			}
+			if(!started()) start();
+			wait();
+			if(!d && st->ePs.size()) std::rethrow_exception(st->ePs[0]);
 		}
 		void detach(){
 			d = true;
-			th.detach();
 		}
 		void interrupt() throw(kul::threading::InterruptionException){ }
 		const std::vector<std::exception_ptr> exceptionPointers() {
-			return ePs;
+			kul::threading::ScopedLock<kul::FastMutex> lock(st->mu);
+			return st->ePs;
+		}
+		const std::vector<threading::TaskTime> taskTimes() {
+			kul::threading::ScopedLock<kul::FastMutex> lock(st->mu);
+			return st->tts;
 		}
 };
 
@@ -115,29 +409,7 @@ class PredicatedThreadPool : public ThreadPool{
 		void start() throw (std::exception) {
 			if(started()) KEXCEPT(Exception, "ThreadPool is already started");
 			setStarted();
-			unsigned int c = 0;
-			while(c < ps){
-				for(unsigned int i = ts.size(); i < m && c < ps; i++){
-					c++;
-					std::shared_ptr<kul::Thread> at = std::make_shared<kul::Thread>(to);
-					at->run();
-					ts.push_back(at);
-					this_thread::nSleep(__KUL_THREAD_SPAWN_WAIT__);
-				}
-				const std::shared_ptr<kul::Thread>* del = 0;
-				for(const auto& t : ts){
-					if(t->finished()){
-						t->join();
-						if(t->exception() != std::exception_ptr()){
-							if(!d) std::rethrow_exception(t->exception());
-							ePs.push_back(t->exception());
-						}
-						del = &t; break;
-					}
-				}
-				this_thread::sleep(11);
-				if(del) ts.erase(std::remove(ts.begin(), ts.end(), *del), ts.end());
-			}
+			launch(ps);
 		}
 	public:
 		template <class T> PredicatedThreadPool(const T& t, P& pr) 			: ThreadPool(t) 	, p(pr), ps(p.size()){}
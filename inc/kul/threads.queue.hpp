@@ -0,0 +1,126 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_THREADS_QUEUE_HPP_
+#define _KUL_THREADS_QUEUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "kul/defs.hpp"
+#include "kul/except.hpp"
+
+namespace kul{
+
+/**
+	Bounded multi producer / multi consumer queue, after Dmitry Vyukov's sequenced ring buffer.
+	Each cell carries a sequence number telling producers and consumers whose turn it is,
+	so push and pop are a single CAS on the head or tail in the uncontended case.
+	Capacity is rounded up to a power of two. size() is approximate under contention.
+*/
+template <class T>
+class LockFreeQueue{
+	private:
+		class Cell{
+			public:
+				std::atomic<size_t> s;
+				T t;
+		};
+		const size_t m;
+		std::unique_ptr<Cell[]> cs;
+		char p0[__KUL_CACHE_LINE__];
+		std::atomic<size_t> h;
+		char p1[__KUL_CACHE_LINE__ - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t> t;
+		char p2[__KUL_CACHE_LINE__ - sizeof(std::atomic<size_t>)];
+
+		static size_t POW2(const size_t& c){
+			size_t p = 2;
+			while(p < c) p <<= 1;
+			return p;
+		}
+		template <class V> bool put(V&& v){
+			Cell* c;
+			size_t p = h.load(std::memory_order_relaxed);
+			while(true){
+				c = &cs[p & m];
+				const size_t s = c->s.load(std::memory_order_acquire);
+				const intptr_t d = (intptr_t) s - (intptr_t) p;
+				if(d == 0){
+					if(h.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) break;
+				}
+				else if(d < 0) return false;
+				else p = h.load(std::memory_order_relaxed);
+			}
+			c->t = std::forward<V>(v);
+			c->s.store(p + 1, std::memory_order_release);
+			return true;
+		}
+	public:
+		LockFreeQueue(const size_t& c) : m(POW2(c) - 1), cs(new Cell[m + 1]), h(0), t(0){
+			for(size_t i = 0; i <= m; i++) cs[i].s.store(i, std::memory_order_relaxed);
+		}
+		LockFreeQueue(const LockFreeQueue&) = delete;
+		LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+		bool push(const T& v){ return put(v); }
+		bool push(T&& v){ return put(std::move(v)); }
+		bool pop(T& v){
+			return consume([&v](T& t){ v = std::move(t); });
+		}
+		/** pops with f given the element in place, nothing is moved or destroyed */
+		template <class F> bool consume(const F& f){
+			Cell* c;
+			size_t p = t.load(std::memory_order_relaxed);
+			while(true){
+				c = &cs[p & m];
+				const size_t s = c->s.load(std::memory_order_acquire);
+				const intptr_t d = (intptr_t) s - (intptr_t) (p + 1);
+				if(d == 0){
+					if(t.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) break;
+				}
+				else if(d < 0) return false;
+				else p = t.load(std::memory_order_relaxed);
+			}
+			f(c->t);
+			c->s.store(p + m + 1, std::memory_order_release);
+			return true;
+		}
+		size_t size() const {
+			const size_t a = h.load(std::memory_order_relaxed), b = t.load(std::memory_order_relaxed);
+			return a > b ? a - b : 0;
+		}
+		bool empty() 		const { return size() == 0; }
+		size_t capacity() 	const { return m + 1; }
+};
+
+}// END NAMESPACE kul
+#endif /* _KUL_THREADS_QUEUE_HPP_ */
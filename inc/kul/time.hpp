@@ -33,8 +33,16 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <ctime>
 #include <chrono>
+#include <vector>
+#include <cstdio>
 #include <sstream>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 #include "kul/string.hpp"
 
 namespace kul {
@@ -55,14 +63,35 @@ class Now{
 class DateTime{
 	private:
 		static const std::string MILLIS(){
-			std::string s(std::to_string(Now::MILLIS()));
-			return s.substr(s.length() - 3);
+			char c[12];
+			snprintf(c, sizeof(c), "%03u", (unsigned) (Now::MILLIS() % 1000));
+			return std::string(c);
 		}
 	public:
+		static void LOCAL(const std::time_t& t, std::tm& tm){
+#ifdef _WIN32
+			localtime_s(&tm, &t);
+#else
+			localtime_r(&t, &tm);
+#endif
+		}
 		static const std::string AS(const std::time_t t, std::string f = "%Y-%m-%d-%H:%M:%S"){
 			kul::String::replace(f, "%i", MILLIS());
+			std::tm tm;
+			LOCAL(t, tm);
+			char buffer [80];
+			std::strftime(buffer, 80, f.c_str(), &tm);
+			return std::string(buffer);
+		}
+		static const std::string AS(const std::chrono::system_clock::time_point& p, std::string f = "%Y-%m-%d-%H:%M:%S"){
+			std::string ms(std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(p.time_since_epoch()).count() % 1000));
+			ms.insert(0, 3 - ms.size(), '0');
+			kul::String::replace(f, "%i", ms);
+			const std::time_t t = std::chrono::system_clock::to_time_t(p);
+			std::tm tm;
+			LOCAL(t, tm);
 			char buffer [80];
-			std::strftime(buffer, 80, f.c_str(), std::localtime(&t));
+			std::strftime(buffer, 80, f.c_str(), &tm);
 			return std::string(buffer);
 		}
 		static const std::string AS(const std::string& epoch, const std::string& f = "%Y-%m-%d-%H:%M:%S"){
@@ -76,5 +105,93 @@ class DateTime{
 			return AS(std::time(NULL), f);
 		}
 };
+
+namespace time{
+/**
+	Monotonic time for measuring intervals, unaffected by wall clock changes.
+	COARSE trades resolution (typically a few milliseconds) for a cheaper read,
+	TICKS is the raw cycle counter where available and NANOS otherwise.
+*/
+class Monotonic{
+	public:
+		static int64_t NANOS(){
+#if defined(__linux__)
+			struct timespec t;
+			clock_gettime(CLOCK_MONOTONIC, &t);
+			return (int64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+		static int64_t COARSE(){
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+			struct timespec t;
+			clock_gettime(CLOCK_MONOTONIC_COARSE, &t);
+			return (int64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+#else
+			return NANOS();
+#endif
+		}
+		static uint64_t TICKS(){
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return NANOS();
+#endif
+		}
+};
+
+/**
+	Wall clock formatter for a fixed strftime format plus "%i" milliseconds and "%f" microseconds.
+	The strftime output is cached and only rendered again when the second changes,
+	sub second fields are written arithmetically. Not thread safe, use one per thread.
+*/
+class Clock{
+	private:
+		std::time_t c;
+		std::vector<char> ks;
+		std::vector<std::string> fs, rs;
+		void cache(const std::time_t& t){
+			std::tm tm;
+			DateTime::LOCAL(t, tm);
+			char b[80];
+			for(size_t i = 0; i < fs.size(); i++)
+				rs[i].assign(b, fs[i].empty() ? 0 : std::strftime(b, sizeof(b), fs[i].c_str(), &tm));
+			c = t;
+		}
+	public:
+		Clock(const std::string& f = "%Y-%m-%d-%H:%M:%S") : c(-1){
+			size_t p = 0;
+			for(size_t i = 0; i + 1 < f.size(); i++){
+				if(f[i] != '%') continue;
+				if(f[i + 1] == 'i' || f[i + 1] == 'f'){
+					fs.push_back(f.substr(p, i - p));
+					ks.push_back(f[i + 1]);
+					p = i + 2;
+				}
+				i++;
+			}
+			fs.push_back(f.substr(p));
+			rs.resize(fs.size());
+		}
+		void render(std::string& s, const std::chrono::system_clock::time_point& p){
+			const int64_t u = std::chrono::duration_cast<std::chrono::microseconds>(p.time_since_epoch()).count();
+			const std::time_t t = std::chrono::system_clock::to_time_t(p);
+			if(t != c) cache(t);
+			char b[8];
+			for(size_t i = 0; i < rs.size(); i++){
+				if(i) s.append(b, ks[i - 1] == 'i'
+					? snprintf(b, sizeof(b), "%03d", (int) (u / 1000 % 1000))
+					: snprintf(b, sizeof(b), "%06d", (int) (u % 1000000)));
+				s += rs[i];
+			}
+		}
+		const std::string render(const std::chrono::system_clock::time_point& p = std::chrono::system_clock::now()){
+			std::string s;
+			render(s, p);
+			return s;
+		}
+};
+} // END NAMESPACE time
 }
 #endif /* _KUL_TIME_HPP_ */
@@ -0,0 +1,88 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_FS_OS_HPP_
+#define _KUL_FS_OS_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <memory>
+#include <functional>
+
+namespace kul{ namespace fs {
+
+/**
+	Directory change notification through inotify, read without blocking by drain()
+	on the calling thread so callers see every change made before the call.
+	f(w, name) is called for every change inside watch w, with a null name when the
+	watch itself is gone. o() is called when the kernel queue overflowed and events were lost.
+*/
+class Watcher{
+	private:
+		int i;
+		std::function<void(const int&, const char*)> f;
+		std::function<void()> o;
+	public:
+		Watcher(const std::function<void(const int&, const char*)>& f, const std::function<void()>& o) : i(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), f(f), o(o){}
+		~Watcher(){
+			if(i >= 0) close(i);
+		}
+		Watcher(const Watcher&) = delete;
+		Watcher& operator=(const Watcher&) = delete;
+		bool ok() const { return i >= 0; }
+		// watch descriptor for directory d, negative if it cannot be watched
+		int watch(const std::string& d){
+			return ok() ? inotify_add_watch(i, d.c_str(), IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB
+				| IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) : -1;
+		}
+		// delivers every queued event, not thread safe
+		void drain(){
+			if(!ok()) return;
+			alignas(struct inotify_event) char b[16384];
+			while(true){
+				const ssize_t n = ::read(i, b, sizeof(b));
+				if(n < 0 && errno == EINTR) continue;
+				if(n <= 0) return;
+				for(char* c = b; c < b + n; ){
+					const struct inotify_event* e = (const struct inotify_event*) c;
+					c += sizeof(struct inotify_event) + e->len;
+					if(e->mask & IN_Q_OVERFLOW) o();
+					else if(e->mask & IN_IGNORED) f(e->wd, 0);
+					else f(e->wd, e->len ? e->name : "");
+				}
+			}
+		}
+};
+
+}}
+#endif /* _KUL_FS_OS_HPP_ */
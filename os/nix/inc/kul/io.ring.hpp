@@ -0,0 +1,170 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_IO_RING_HPP_
+#define _KUL_IO_RING_HPP_
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include <vector>
+
+namespace kul{ namespace io {
+
+/**
+	Minimal io_uring submission/completion ring driven by raw syscalls, no liburing needed.
+	ok() is false when the kernel cannot provide a ring supporting IORING_OP_READ/WRITE.
+	prep() and submit() need external locking, wait() and reap() may run on one other thread.
+*/
+class Ring{
+	private:
+		int f;
+		bool x = 0;
+		unsigned *sh, *st, *sm, *sa, *ch, *ct, *cm;
+		unsigned n, p;
+		size_t sz, cz;
+		void *sr, *cr;
+		struct io_uring_sqe* sq;
+		struct io_uring_cqe* cq;
+		bool probe(){
+			std::vector<char> b(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+			struct io_uring_probe* pr = (struct io_uring_probe*) b.data();
+			if(syscall(__NR_io_uring_register, f, IORING_REGISTER_PROBE, pr, 256) < 0) return 0;
+			return pr->last_op >= IORING_OP_WRITE
+				&& (pr->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+				&& (pr->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+		}
+		void close(){
+			if(sq != MAP_FAILED) munmap(sq, n * sizeof(struct io_uring_sqe));
+			if(cr != MAP_FAILED && cr != sr) munmap(cr, cz);
+			if(sr != MAP_FAILED) munmap(sr, sz);
+			if(f >= 0) ::close(f);
+			f = -1;
+		}
+	public:
+		Ring(const unsigned& e) : f(-1), n(0), p(0), sz(0), cz(0), sr(MAP_FAILED), cr(MAP_FAILED), sq((struct io_uring_sqe*) MAP_FAILED){
+			struct io_uring_params ps;
+			memset(&ps, 0, sizeof(ps));
+			f = syscall(__NR_io_uring_setup, e, &ps);
+			if(f < 0) return;
+			n = ps.sq_entries;
+			x = ps.features & IORING_FEAT_EXT_ARG;
+			sz = ps.sq_off.array + ps.sq_entries * sizeof(unsigned);
+			cz = ps.cq_off.cqes + ps.cq_entries * sizeof(struct io_uring_cqe);
+			if(ps.features & IORING_FEAT_SINGLE_MMAP && cz > sz) sz = cz;
+			sr = mmap(0, sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, f, IORING_OFF_SQ_RING);
+			if(sr == MAP_FAILED){ close(); return; }
+			cr = ps.features & IORING_FEAT_SINGLE_MMAP ? sr
+				: mmap(0, cz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, f, IORING_OFF_CQ_RING);
+			if(cr == MAP_FAILED){ close(); return; }
+			sq = (struct io_uring_sqe*) mmap(0, n * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, f, IORING_OFF_SQES);
+			if(sq == MAP_FAILED){ close(); return; }
+			sh = (unsigned*) ((char*) sr + ps.sq_off.head);
+			st = (unsigned*) ((char*) sr + ps.sq_off.tail);
+			sm = (unsigned*) ((char*) sr + ps.sq_off.ring_mask);
+			sa = (unsigned*) ((char*) sr + ps.sq_off.array);
+			ch = (unsigned*) ((char*) cr + ps.cq_off.head);
+			ct = (unsigned*) ((char*) cr + ps.cq_off.tail);
+			cm = (unsigned*) ((char*) cr + ps.cq_off.ring_mask);
+			cq = (struct io_uring_cqe*) ((char*) cr + ps.cq_off.cqes);
+			if(!probe()) close();
+		}
+		~Ring(){ close(); }
+		Ring(const Ring&) = delete;
+		Ring& operator=(const Ring&) = delete;
+
+		bool ok() const { return f >= 0; }
+		// queues one request, false if the submission ring is full
+		bool prep(const unsigned char& op, const int& d, const void* b, const unsigned& l, const uint64_t& o, const uint64_t& u){
+			const unsigned t = *st;
+			if(t - __atomic_load_n(sh, __ATOMIC_ACQUIRE) >= n) return 0;
+			const unsigned i = t & *sm;
+			struct io_uring_sqe* e = &sq[i];
+			memset(e, 0, sizeof(*e));
+			e->opcode = op;
+			e->fd = d;
+			e->addr = (uint64_t) b;
+			e->len = l;
+			e->off = o;
+			e->user_data = u;
+			sa[i] = i;
+			__atomic_store_n(st, t + 1, __ATOMIC_RELEASE);
+			p++;
+			return 1;
+		}
+		// hands queued requests to the kernel
+		int submit(){
+			int r;
+			do r = syscall(__NR_io_uring_enter, f, p, 0, 0, 0, 0);
+			while(r < 0 && errno == EINTR);
+			if(r > 0) p -= r;
+			return r;
+		}
+		// blocks until at least one completion is available, submits nothing
+		int wait(){
+			int r;
+			do r = syscall(__NR_io_uring_enter, f, 0, 1, IORING_ENTER_GETEVENTS, 0, 0);
+			while(r < 0 && errno == EINTR);
+			return r;
+		}
+		// as wait() but gives up with ETIME after ms where the kernel supports it, blocks otherwise
+		int wait(const long& ms){
+			if(!x) return wait();
+			struct __kernel_timespec ts;
+			ts.tv_sec  = ms / 1000;
+			ts.tv_nsec = ms % 1000 * 1000000;
+			struct io_uring_getevents_arg a;
+			memset(&a, 0, sizeof(a));
+			a.ts = (uint64_t) &ts;
+			int r;
+			do r = syscall(__NR_io_uring_enter, f, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &a, sizeof(a));
+			while(r < 0 && errno == EINTR);
+			return r;
+		}
+		// takes one completion if available
+		bool reap(uint64_t& u, int& r){
+			const unsigned h = *ch;
+			if(h == __atomic_load_n(ct, __ATOMIC_ACQUIRE)) return 0;
+			const struct io_uring_cqe& e = cq[h & *cm];
+			u = e.user_data;
+			r = e.res;
+			__atomic_store_n(ch, h + 1, __ATOMIC_RELEASE);
+			return 1;
+		}
+		const unsigned& pending()	const { return p; }
+		const unsigned& entries()	const { return n; }
+};
+
+}}
+#endif /* _KUL_IO_RING_HPP_ */
@@ -0,0 +1,211 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_IO_OS_HPP_
+#define _KUL_IO_OS_HPP_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <memory>
+#include <string.h>
+#include <type_traits>
+
+#include "kul/os.hpp"
+#include "kul/defs.hpp"
+#include "kul/string.hpp"
+
+namespace kul{ namespace io {
+
+typedef int Descriptor;
+
+// positioned read/write retrying on EINTR, pipes fall back to plain read/write
+inline long PREAD(const Descriptor& f, char* b, const size_t& n, const uint64_t& o){
+	ssize_t r;
+	do r = pread(f, b, n, o); while(r < 0 && errno == EINTR);
+	if(r < 0 && errno == ESPIPE)
+		do r = ::read(f, b, n); while(r < 0 && errno == EINTR);
+	return r;
+}
+inline long PWRITE(const Descriptor& f, const char* b, const size_t& n, const uint64_t& o){
+	ssize_t r;
+	do r = pwrite(f, b, n, o); while(r < 0 && errno == EINTR);
+	if(r < 0 && errno == ESPIPE)
+		do r = ::write(f, b, n); while(r < 0 && errno == EINTR);
+	return r;
+}
+
+/**
+	File mapped into memory. The single argument form maps an existing file read only,
+	leaving data() null if the file cannot be mapped (empty files, pipes, procfs).
+	The sized form opens read/write, creating the file and resizing it to s bytes.
+*/
+class MemoryMap{
+	private:
+		int f;
+		size_t s;
+		char* p;
+		void map(const int& prot){
+			void* m = mmap(0, s, prot, MAP_SHARED, f, 0);
+			if(m != MAP_FAILED) p = (char*) m;
+		}
+	public:
+		MemoryMap(const std::string& n) : f(open(n.c_str(), O_RDONLY)), s(0), p(0){
+			if(f < 0) KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be opened");
+			struct stat st;
+			if(fstat(f, &st) == 0 && S_ISREG(st.st_mode)) s = st.st_size;
+			if(s) map(PROT_READ);
+		}
+		MemoryMap(const std::string& n, const size_t& s) : f(open(n.c_str(), O_RDWR | O_CREAT, 0644)), s(s), p(0){
+			if(f < 0) KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be opened");
+			if(ftruncate(f, s) == 0) map(PROT_READ | PROT_WRITE);
+			if(!p){
+				close(f);
+				KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be mapped");
+			}
+		}
+		~MemoryMap(){
+			if(p) munmap(p, s);
+			close(f);
+		}
+		MemoryMap(const MemoryMap&) = delete;
+		MemoryMap& operator=(const MemoryMap&) = delete;
+
+		char* data()				const { return p; }
+		const size_t& size()		const { return s; }
+		int descriptor()			const { return f; }
+		void sync(){
+			if(p) msync(p, s, MS_ASYNC);
+		}
+		void sequential(){
+			if(p) madvise(p, s, MADV_SEQUENTIAL);
+		}
+		// reads n bytes at offset o without mapping
+		long read(char* b, const size_t& n, const uint64_t& o) const {
+			return PREAD(f, b, n, o);
+		}
+};
+
+/**
+	Buffered file writer with explicit flush policy. Writes are copied into a buffer of z bytes,
+	anything larger than the space left goes out with the pending buffer in one writev.
+	Data reaches the file when the buffer fills, on flush() and on destruction, sync() also fsyncs.
+	A known final size p reserves disk space up front where the platform supports it.
+*/
+class FastWriter{
+	private:
+		int f;
+		size_t s, z;
+		std::unique_ptr<char[]> b;
+		void out(struct iovec* v, int n){
+			while(n){
+				ssize_t w = writev(f, v, n);
+				if(w < 0){
+					if(errno == EINTR) continue;
+					KEXCEPT(fs::Exception, "FastWriter : write failed, errno " + std::to_string(errno));
+				}
+				for(; n && (size_t) w >= v->iov_len; v++, n--) w -= v->iov_len;
+				if(n){
+					v->iov_base = (char*) v->iov_base + w;
+					v->iov_len -= w;
+				}
+			}
+		}
+	public:
+		FastWriter(const std::string& n, const size_t& z = __KUL_IO_BUFFER__, const uint64_t& p = 0, bool a = 0)
+				: f(open(n.c_str(), O_WRONLY | O_CREAT | (a ? O_APPEND : O_TRUNC), 0644)), s(0), z(z ? z : 1), b(new char[this->z]){
+			if(f < 0) KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be opened");
+#ifdef __linux__
+			if(p) fallocate(f, FALLOC_FL_KEEP_SIZE, 0, p);
+#else
+			(void) p;
+#endif
+		}
+		FastWriter(const File& c, const size_t& z = __KUL_IO_BUFFER__, const uint64_t& p = 0, bool a = 0) : FastWriter(c.full(), z, p, a){}
+		~FastWriter(){
+			try{ flush(); }catch(const fs::Exception&){}
+			close(f);
+		}
+		FastWriter(const FastWriter&) = delete;
+		FastWriter& operator=(const FastWriter&) = delete;
+
+		FastWriter& write(const char* c, const size_t& n){
+			if(s + n <= z){
+				memcpy(b.get() + s, c, n);
+				s += n;
+				return *this;
+			}
+			struct iovec v[2];
+			v[0].iov_base = b.get();
+			v[0].iov_len = s;
+			v[1].iov_base = (void*) c;
+			v[1].iov_len = n;
+			s = 0;
+			out(v, 2);
+			return *this;
+		}
+		FastWriter& write(const StringView& v){
+			return write(v.data(), v.size());
+		}
+		FastWriter& operator<<(const StringView& v){
+			return write(v.data(), v.size());
+		}
+		FastWriter& operator<<(const char* c){
+			return write(c, strlen(c));
+		}
+		FastWriter& operator<<(const char& c){
+			return write(&c, 1);
+		}
+		template <class T, class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+		FastWriter& operator<<(const T& t){
+			return *this << StringView(std::to_string(t));
+		}
+		void flush(){
+			if(!s) return;
+			struct iovec v;
+			v.iov_base = b.get();
+			v.iov_len = s;
+			s = 0;
+			out(&v, 1);
+		}
+		void sync(){
+			flush();
+			if(fsync(f)) KEXCEPT(fs::Exception, "FastWriter : sync failed, errno " + std::to_string(errno));
+		}
+		const size_t& buffered()	const { return s; }
+		int descriptor()			const { return f; }
+};
+
+}}
+#endif /* _KUL_IO_OS_HPP_ */
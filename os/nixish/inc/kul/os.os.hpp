@@ -32,6 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _KUL_OS_OS_HPP_
 
 #include <pwd.h>
+#include <errno.h>
 #include <thread>
 #include <fstream>
 #include <stdio.h>
@@ -39,24 +40,215 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <unistd.h>
 #include <algorithm>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#endif
 
 namespace kul{
 
 class Dir;
+class File;
 namespace fs {
 
-class KulTimeStampsResolver{
+/**
+	Copies file contents without passing through user space where the kernel allows.
+	On linux tries a reflink (FICLONE), then copy_file_range, then sendfile, finally read/write.
+	Each step continues from the file offsets left by the previous one.
+*/
+class KulFileCopier{
+	private:
+		static bool USER(const int& i, const int& o){
+			char b[65536];
+			while(true){
+				ssize_t r = read(i, b, sizeof(b));
+				if(r < 0 && errno == EINTR) continue;
+				if(r <= 0) return r == 0;
+				for(ssize_t w = 0, d = 0; d < r; d += w){
+					w = write(o, b + d, r - d);
+					if(w < 0 && errno == EINTR) w = 0;
+					else if(w <= 0) return 0;
+				}
+			}
+		}
+#ifdef __linux__
+		// 1 when done, 0 when the kernel cannot copy between these files, -1 on error
+		static int KERNEL(const int& i, const int& o, const bool& range){
+			bool any = 0;
+			while(true){
+				ssize_t r;
+#ifdef __NR_copy_file_range
+				if(range) r = syscall(__NR_copy_file_range, i, (loff_t*) 0, o, (loff_t*) 0, (size_t) 1 << 30, 0u);
+				else
+#endif
+				r = sendfile(o, i, 0, (size_t) 1 << 30);
+				if(r == 0) return 1;
+				if(r > 0){
+					any = 1;
+					continue;
+				}
+				if(errno == EINTR) continue;
+				if(!any && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) return 0;
+				return -1;
+			}
+		}
+#endif
+		static bool COPY(const char*const s, const char*const d){
+			const int i = open(s, O_RDONLY | O_CLOEXEC);
+			if(i < 0) return 0;
+			struct stat st;
+			if(fstat(i, &st)){
+				close(i);
+				return 0;
+			}
+			const int o = open(d, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 07777);
+			if(o < 0){
+				close(i);
+				return 0;
+			}
+			int r = 0;
+#ifdef __linux__
+#ifdef FICLONE
+			if(ioctl(o, FICLONE, i) == 0) r = 1;
+#endif
+			// procfs and friends report no size and only work with read
+			if(!r && st.st_size) r = KERNEL(i, o, 1);
+			if(!r && st.st_size) r = KERNEL(i, o, 0);
+#endif
+			if(!r) r = USER(i, o) ? 1 : -1;
+			close(i);
+			return close(o) == 0 && r == 1;
+		}
+		friend class kul::File;
+};
+
+/**
+	Directory listing through descriptors. Entry types come from the directory entry itself,
+	getdents64 on linux and readdir elsewhere, and are only stat'd for symbolic links
+	or filesystems that leave them unknown. Links are reported by the type of their target unless l is false.
+*/
+class Listing{
 	private:
-		static void GET(const char*const p, uint& a, uint& c, uint& m){
-			struct stat att;
-			if(stat(p, &att) != -1){
-				a = att.st_atime;
-				m = att.st_mtime;
+		static bool DIRECTORY(const int& h, const char* n, const unsigned char& t, const bool& l){
+			if(t == DT_DIR) return 1;
+			if(t != DT_UNKNOWN && (t != DT_LNK || !l)) return 0;
+			struct stat st;
+			return fstatat(h, n, &st, l ? 0 : AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+		}
+#ifdef __linux__
+		struct Dirent64{
+			uint64_t i;
+			int64_t o;
+			unsigned short l;
+			unsigned char t;
+			char n[1];
+		};
+#endif
+	public:
+		typedef int Handle;
+		static Handle NONE()						{ return -1; }
+		static bool VALID(const Handle& h)			{ return h >= 0; }
+		static void CLOSE(const Handle& h)			{ if(h >= 0) close(h); }
+		// opens n relative to h, or as a path when h is NONE()
+		static Handle OPEN(const Handle& h, const char* n){
+			int f;
+			do f = openat(h < 0 ? AT_FDCWD : h, n, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			while(f < 0 && errno == EINTR);
+			return f;
+		}
+		// removes n relative to h, or as a path when h is NONE(), d for directories
+		static bool UNLINK(const Handle& h, const char* n, const bool& d){
+			return unlinkat(h < 0 ? AT_FDCWD : h, n, d ? AT_REMOVEDIR : 0) == 0;
+		}
+		// like OPEN but only usable as the base of *at calls, O_PATH on linux so no read access is checked
+		static Handle PATH(const Handle& h, const char* n){
+#ifdef O_PATH
+			int f;
+			do f = openat(h < 0 ? AT_FDCWD : h, n, O_PATH | O_DIRECTORY | O_CLOEXEC);
+			while(f < 0 && errno == EINTR);
+			return f;
+#else
+			return OPEN(h, n);
+#endif
+		}
+		// calls f(const char* name, bool directory) for each entry but "." and "..", false if h cannot be read
+		template <class F> static bool LIST(const Handle& h, F f, const bool& l = 1){
+#ifdef __linux__
+			alignas(8) char b[32768];
+			while(true){
+				long n = syscall(SYS_getdents64, h, b, sizeof(b));
+				if(n < 0 && errno == EINTR) continue;
+				if(n <= 0) return n == 0;
+				for(long o = 0; o < n; ){
+					const Dirent64* e = (const Dirent64*) (b + o);
+					o += e->l;
+					if(e->n[0] == '.' && (!e->n[1] || (e->n[1] == '.' && !e->n[2]))) continue;
+					f(e->n, DIRECTORY(h, e->n, e->t, l));
+				}
+			}
+#else
+			const int c = dup(h);
+			DIR* d = c < 0 ? 0 : fdopendir(c);
+			if(!d){
+				if(c >= 0) close(c);
+				return 0;
+			}
+			for(struct dirent* e = readdir(d); e; e = readdir(d)){
+				if(e->d_name[0] == '.' && (!e->d_name[1] || (e->d_name[1] == '.' && !e->d_name[2]))) continue;
+				f(e->d_name, DIRECTORY(h, e->d_name, e->d_type, l));
+			}
+			closedir(d);
+			return 1;
+#endif
+		}
+};
+
+/**
+	Metadata of one path from a single stat, relative to a Listing handle or NONE() for paths.
+	Times are nanoseconds since the epoch, changed() is the inode change time.
+*/
+class Stat{
+	private:
+		bool e, d;
+		int64_t a, c, m;
+		uint64_t i, s;
+		static int64_t NANOS(const struct timespec& t){
+			return (int64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+		}
+	public:
+		Stat() : e(0), d(0), a(0), c(0), m(0), i(0), s(0){}
+		bool exists()				const { return e; }
+		bool directory()			const { return d; }
+		const int64_t& accessed()	const { return a; }
+		const int64_t& changed()	const { return c; }
+		const int64_t& modified()	const { return m; }
+		const uint64_t& inode()		const { return i; }
+		const uint64_t& size()		const { return s; }
+		static Stat AT(const Listing::Handle& h, const char* n){
+			Stat r;
+			struct stat st;
+			if(fstatat(h < 0 ? AT_FDCWD : h, n, &st, 0) == 0){
+				r.e = 1;
+				r.d = S_ISDIR(st.st_mode);
+#ifdef __APPLE__
+				r.a = NANOS(st.st_atimespec);
+				r.c = NANOS(st.st_ctimespec);
+				r.m = NANOS(st.st_mtimespec);
+#else
+				r.a = NANOS(st.st_atim);
+				r.c = NANOS(st.st_ctim);
+				r.m = NANOS(st.st_mtim);
+#endif
+				r.i = st.st_ino;
+				r.s = st.st_size;
 			}
+			return r;
 		}
-		friend class kul::Dir;
 };
 
 } // END NAMESPACE fs
@@ -32,20 +32,38 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _KUL_PROC_HPP_
 
 #include <queue>
+#include <mutex>
 #include <memory>
 #include <string>
+#include <vector>
 #include <sstream>
+#include <poll.h>
 #include <fcntl.h>
+#include <spawn.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <signal.h>
 #include <unistd.h>
 #include <stdexcept>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <condition_variable>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define _KUL_PROC_SPAWN_CHDIR_
+#endif
+
+extern char** environ;
 
 #include "kul/os.hpp"
 #include "kul/log.hpp"
+#include "kul/defs.hpp"
+#include "kul/threads.hpp"
 #include "kul/proc.base.hpp"
 
 namespace kul {
@@ -61,25 +79,139 @@ inline void kill(const int& e){
 
 class Process : public kul::AProcess{
 	private:
-		int inFd[2];
-		int outFd[2];
-		int errFd[2];
-		int popPip[3];
-		int cStat; //child status
+		int inFd[2] = {-1, -1};
+		int outFd[2] = {-1, -1};
+		int errFd[2] = {-1, -1};
+		int pfd = -1;
+		int cStat = 0; //child status
+		bool reaped = 0;
+		proc::Usage ru;
+		friend class ProcessGroup;
 
 		inline int recall(const int& s){
 			int ret; 
 			while((ret = (s)) < 0x0 && (errno == EINTR)){}
 			return ret;
 		}
+		static int PIPE(int fds[2]){
+#ifdef __linux__
+			return pipe2(fds, O_CLOEXEC);
+#else
+			if(pipe(fds) < 0) return -1;
+			fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+			fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+			return 0;
+#endif
+		}
+		static void CLOSE(int& fd){
+			if(fd < 0) return;
+			close(fd);
+			fd = -1;
+		}
+		/** -1 if the kernel has no pidfd_open, exit is then polled with waitpid */
+		static int PIDFD(const pid_t& p){
+#if defined(__linux__) && defined(SYS_pidfd_open)
+			return syscall(SYS_pidfd_open, p, 0);
+#else
+			return -1;
+#endif
+		}
+		void reap(const struct rusage& r){
+			ru.e = proc::Usage::NOW();
+			ru.u = r.ru_utime.tv_sec * 1000000000ULL + r.ru_utime.tv_usec * 1000ULL;
+			ru.s = r.ru_stime.tv_sec * 1000000000ULL + r.ru_stime.tv_usec * 1000ULL;
+#ifdef __APPLE__
+			ru.r = r.ru_maxrss;
+#else
+			ru.r = r.ru_maxrss * 1024ULL;
+#endif
+			ru.mn = r.ru_minflt;
+			ru.mj = r.ru_majflt;
+			ru.v  = r.ru_nvcsw;
+			ru.iv = r.ru_nivcsw;
+			usage(ru);
+		}
+		/** false once the pipe is at EOF */
+		bool drain(int& fd, char* b, const bool& e){
+			while(fd >= 0){
+				const ssize_t r = read(fd, b, __KUL_IO_BUFFER__);
+				if(r > 0){
+					if(e) err(b, r);
+					else  out(b, r);
+				}
+				else if(r == 0) CLOSE(fd);
+				else if(errno == EAGAIN || errno == EWOULDBLOCK) return true;
+				else if(errno != EINTR) error(__LINE__, "read on child output failed");
+			}
+			return false;
+		}
+		/** argv and envp point into args()/vars(), valid until either changes */
+		static void ARGV(const std::vector<std::string>& as, std::vector<char*>& v){
+			v.reserve(as.size() + 1);
+			for(const std::string& a : as) v.push_back(const_cast<char*>(a.c_str()));
+			v.push_back(nullptr);
+		}
+		static void ENVP(const kul::hash::map::S2S& evs, std::vector<std::string>& s, std::vector<char*>& v){
+			for(char** e = environ; *e; e++){
+				const char* q = strchr(*e, '=');
+				if(q && evs.count(std::string(*e, q - *e))) continue;
+				v.push_back(*e);
+			}
+			s.reserve(evs.size());
+			for(const auto& ev : evs) s.push_back(ev.first + "=" + ev.second);
+			for(std::string& e : s) v.push_back(&e[0]);
+			v.push_back(nullptr);
+		}
+		/** PATH lookup must use the child's PATH if it is overridden */
+		static std::string WHICH(const std::string& c, const kul::hash::map::S2S& evs){
+			if(c.find('/') != std::string::npos || !evs.count("PATH")) return c;
+			for(const std::string& d : kul::String::split((*evs.find("PATH")).second, ':')){
+				const std::string p(d + "/" + c);
+				if(access(p.c_str(), X_OK) == 0) return p;
+			}
+			return c;
+		}
+		void spawn(){
+			std::vector<char*> as, es;
+			std::vector<std::string> ess;
+			ARGV(args(), as);
+			char** envp = environ;
+			if(vars().size()){
+				ENVP(vars(), ess, es);
+				envp = &es[0];
+			}
+			const std::string c(WHICH(args()[0], vars()));
+			posix_spawn_file_actions_t fa;
+			posix_spawn_file_actions_init(&fa);
+			posix_spawn_file_actions_adddup2(&fa, inFd[0], 0);
+			posix_spawn_file_actions_adddup2(&fa, outFd[1], 1);
+			posix_spawn_file_actions_adddup2(&fa, errFd[1], 2);
+			for(const int& fd : {inFd[0], inFd[1], outFd[0], outFd[1], errFd[0], errFd[1]})
+				if(fd > 2) posix_spawn_file_actions_addclose(&fa, fd);
+#ifdef _KUL_PROC_SPAWN_CHDIR_
+			if(!directory().empty()) posix_spawn_file_actions_addchdir_np(&fa, directory().c_str());
+#endif
+			pid_t p = 0;
+			int ret = posix_spawnp(&p, c.c_str(), &fa, 0, &as[0], envp);
+			posix_spawn_file_actions_destroy(&fa);
+			if(ret) error(__LINE__, "Failed to spawn " + args()[0] + " : " + strerror(ret));
+			pid(p);
+		}
 	protected:
 		int	child(){
-			std::string s(args()[0]);
-			char** as = new char*[args().size() + 1]; // doesnt' need deleting - process exists after method
-			int i = 0;
-			for(const std::string& c : args()){ as[i] = const_cast<char*>(c.c_str()); i++; }
-			as[i] = NULL;
-			return execvp(s.c_str(), as);
+			std::vector<char*> as;
+			ARGV(args(), as);
+			return execvp(args()[0].c_str(), &as[0]);
+		}
+		/** posix_spawn avoids copying the parent page tables, fork is kept for older libcs */
+		virtual bool spawnable() const {
+#if defined(__KUL_PROC_FORK__)
+			return false;
+#elif defined(_KUL_PROC_SPAWN_CHDIR_)
+			return true;
+#else
+			return directory().empty();
+#endif
 		}
 		void finish()	{ }
 		void preStart()	{ }
@@ -97,8 +229,10 @@ class Process : public kul::AProcess{
 	protected:
 		void waitForStatus(){
 			int ret = 0;
-			ret = recall(waitpid(pid(), &cStat, 0));
+			struct rusage r;
+			while((ret = wait4(pid(), &cStat, 0, &r)) < 0 && errno == EINTR){}
 			assert(ret);
+			if(ret > 0) reap(r);
 		}
 		void waitExit() throw (kul::proc::ExitException){
 			tearDown();
@@ -107,105 +241,245 @@ class Process : public kul::AProcess{
 			setFinished();
 		}
 		void tearDown(){
-			recall(close(popPip[0]));
-			recall(close(popPip[1]));
-			recall(close(popPip[2]));
-			recall(close(errFd[1]));
-			recall(close(errFd[0]));
-			recall(close(outFd[1]));
-			recall(close(outFd[0]));
-			recall(close(inFd[1]));
-			recall(close(inFd[0]));
+			CLOSE(pfd);
+			CLOSE(errFd[1]);
+			CLOSE(errFd[0]);
+			CLOSE(outFd[1]);
+			CLOSE(outFd[0]);
+			CLOSE(inFd[1]);
+			CLOSE(inFd[0]);
 		}
-		void run() throw (kul::proc::Exception){
+		void fds(struct pollfd* ps) const {
+			ps[0] = {outFd[0], POLLIN, 0};
+			ps[1] = {errFd[0], POLLIN, 0};
+			ps[2] = {pfd, POLLIN, 0};
+		}
+		/** handles poll results from fds(), true once the child has exited and its pipes are drained */
+		bool react(const struct pollfd* ps, char* b) throw (kul::proc::Exception){
+			if(ps[0].revents) drain(outFd[0], b, 0);
+			if(ps[1].revents) drain(errFd[0], b, 1);
+			if(!ps[2].revents){
+				struct rusage r;
+				if(pfd >= 0 || recall(wait4(pid(), &cStat, WNOHANG, &r)) <= 0) return false;
+				reaped = 1;
+				reap(r);
+			}
+			// anything it wrote is already in the pipes, grandchildren holding them are not waited for
+			drain(outFd[0], b, 0);
+			drain(errFd[0], b, 1);
+			if(!reaped) waitForStatus();
+			return true;
+		}
+		/** sleeps in poll until the child writes or exits, no busy waiting */
+		void pump() throw (kul::proc::Exception){
+			std::unique_ptr<char[]> buf(new char[__KUL_IO_BUFFER__]);
+			struct pollfd ps[3];
+			while(true){
+				fds(ps);
+				if(poll(ps, 3, pfd < 0 ? 100 : -1) < 0){
+					if(errno == EINTR) continue;
+					error(__LINE__, "poll on child output failed");
+				}
+				if(react(ps, buf.get())) break;
+			}
+			waitExit();
+		}
+		/** starts the child, when waiting for exit only the parent ends of the pipes are left open */
+		void launch() throw (kul::proc::Exception){
 			int ret = 0;
 
-			if((ret = pipe(inFd)) < 0) 	error(__LINE__, "Failed to pipe in");
-			if((ret = pipe(outFd)) < 0)	error(__LINE__, "Failed to pipe out");
-			if((ret = pipe(errFd)) < 0)	error(__LINE__, "Failed to pipe err");
+			if((ret = PIPE(inFd)) < 0) 	error(__LINE__, "Failed to pipe in");
+			if((ret = PIPE(outFd)) < 0)	error(__LINE__, "Failed to pipe out");
+			if((ret = PIPE(errFd)) < 0)	error(__LINE__, "Failed to pipe err");
 
 			this->preStart();
-			pid(fork());
-			if(pid() > 0){
-				if(this->waitForExit()){ // parent
-					popPip[0] = inFd[1];
-					popPip[1] = outFd[0];
-					popPip[2] = errFd[0];
+			ru.b = proc::Usage::NOW();
+			if(spawnable()) spawn();
+			else{
+				const pid_t f = fork();
+				if(f < 0) error(__LINE__, "Unhandled process id for child: " + std::to_string(f));
+				if(f == 0){ // child
+					close(inFd[1]);
+					close(outFd[0]);
+					close(errFd[0]);
 
+					int ret = 0; //check rets
+					close(0);
+					if((ret = dup(inFd[0])) < 0) 	error(__LINE__, "dup in call failed");
+					close(1);
+					if((ret = dup(outFd[1])) < 0) 	error(__LINE__, "dup out call failed");
+					close(2);
+					if((ret = dup(errFd[1])) < 0) 	error(__LINE__, "dup err call failed");
+
+					/* SETUP EnvVars */ // SET ENV, it's a forked process so it doesn't matter - it'll die soon, like you.
+					for(const std::pair<const std::string, const std::string>& ev : vars())
+						env::SET(ev.first.c_str(), ev.second.c_str());
+
+					if(!this->directory().empty()) kul::env::CWD(this->directory());
+					exit(this->child());
+				}
+				pid(f);
+			}
+			if(!this->waitForExit()) return;
+			CLOSE(inFd[0]);
+			CLOSE(inFd[1]);
+			CLOSE(outFd[1]);
+			CLOSE(errFd[1]);
 		#ifdef __KUL_PROC_BLOCK_ERR__
-					if((ret = fcntl(popPip[1], F_SETFL, O_NONBLOCK)) < 0) error(__LINE__, "Failed nonblocking for popPip[1]");
-					if((ret = fcntl(popPip[2], F_SETFL, O_NONBLOCK)) < 0) error(__LINE__, "Failed nonblocking for popPip[2]");
+			if(fcntl(outFd[0], F_SETFL, O_NONBLOCK) < 0) error(__LINE__, "Failed nonblocking for child out");
+			if(fcntl(errFd[0], F_SETFL, O_NONBLOCK) < 0) error(__LINE__, "Failed nonblocking for child err");
 		#else
-					fcntl(popPip[1], F_SETFL, O_NONBLOCK);
-					fcntl(popPip[2], F_SETFL, O_NONBLOCK);
+			fcntl(outFd[0], F_SETFL, O_NONBLOCK);
+			fcntl(errFd[0], F_SETFL, O_NONBLOCK);
 		#endif
-					fd_set childOutFds;
-					FD_ZERO(&childOutFds);
-					FD_SET(popPip[1], &childOutFds);
-					FD_SET(popPip[2], &childOutFds);
-					close(inFd[1]);
-					bool alive = true;
-
-					do {
-						alive = ::kill(pid(), 0) == 0;
-						if(FD_ISSET(popPip[1], &childOutFds)) {
-							bool b = 0;
-							do {
-								char cOut[1024] = {'\0'};
-								int ret = recall(read(popPip[1], cOut, sizeof(cOut)));
-								cOut[ret > 0 ? ret : 0] = 0;
-								if (ret < 0){
-									if(b && ((errno != EAGAIN) || (errno != EWOULDBLOCK)))
-										error(__LINE__, "read on childout failed");
-									if(((errno != EAGAIN) || (errno != EWOULDBLOCK))) b = 1;
-								}
-								else if (ret) out(cOut);
-								else waitForStatus();
-							} while(ret > 0);
-						}
-						if(FD_ISSET(popPip[2], &childOutFds)) {
-							bool b = 0;
-							do {
-								char cErr[1024] = {'\0'};
-								int ret = recall(read(popPip[2], cErr, sizeof(cErr)));
-								cErr[ret > 0 ? ret : 0] = 0;
-								if (ret < 0){
-									if(b && ((errno != EAGAIN) || (errno != EWOULDBLOCK)))
-										error(__LINE__, "read on childout failed");
-									if(((errno != EAGAIN) || (errno != EWOULDBLOCK))) b = 1;
-								}
-								else if (ret) err(cErr);
-								else waitForStatus();
-							} while(ret > 0);
-						}
-						recall(waitpid(pid(), &cStat, WNOHANG));
-					}while(alive);
-
-					waitExit();
-				}
-			}else if(pid() == 0){ // child
-				close(inFd[1]);
-				close(outFd[0]);
-				close(errFd[0]);
-
-				int ret = 0; //check rets
-				close(0);
-				if((ret = dup(inFd[0])) < 0) 	error(__LINE__, "dup in call failed");
-				close(1);
-				if((ret = dup(outFd[1])) < 0) 	error(__LINE__, "dup out call failed");
-				close(2);
-				if((ret = dup(errFd[1])) < 0) 	error(__LINE__, "dup err call failed");
-
-				/* SETUP EnvVars */ // SET ENV, it's a forked process so it doesn't matter - it'll die soon, like you.
-				for(const std::pair<const std::string, const std::string>& ev : vars())
-					env::SET(ev.first.c_str(), ev.second.c_str());
-
-				if(!this->directory().empty()) kul::env::CWD(this->directory());
-				exit(this->child());
-			}else error(__LINE__, "Unhandled process id for child: " + std::to_string(pid()));
+			pfd = PIDFD(pid());
+		}
+		void run() throw (kul::proc::Exception){
+			launch();
+			if(this->waitForExit()) pump();
 		}
 };
 
+/**
+	Runs queued processes, at most n at a time, pumping the output of all of them on one
+	reactor thread named "kul.proc.group". Callbacks are invoked on that thread after exit,
+	with the launch failure or proc::ExitException if any. Added processes must not be started elsewhere.
+*/
+class ProcessGroup{
+	public:
+		typedef std::function<void(Process&, const std::exception_ptr&)> Callback;
+	private:
+		class Job{
+			public:
+				std::shared_ptr<Process> p;
+				Callback c;
+		};
+		const unsigned int n;
+		bool s = 0;
+		size_t r = 0;
+		int wk[2] = {-1, -1};
+		std::mutex m;
+		std::condition_variable cv;
+		std::exception_ptr e;
+		std::queue<Job> q;
+		std::unique_ptr<kul::Thread> t;
+		void done(Job& j, const std::exception_ptr& x){
+			std::exception_ptr ce;
+			try{
+				if(j.c) j.c(*j.p, x);
+			}catch(...){ ce = std::current_exception(); }
+			std::lock_guard<std::mutex> l(m);
+			if(ce && !e) e = ce;
+			r--;
+			cv.notify_all();
+		}
+		void fail(Job& j, const std::exception_ptr& x){
+			if(j.p->started() && !j.p->finished()){
+				::kill(j.p->pid(), SIGKILL);
+				j.p->waitForStatus();
+				j.p->setFinished();
+			}
+			j.p->tearDown();
+			done(j, x);
+		}
+		void react(){
+			std::unique_ptr<char[]> b(new char[__KUL_IO_BUFFER__]);
+			std::vector<Job> rs;
+			std::vector<struct pollfd> ps;
+			while(true){
+				{
+					std::unique_lock<std::mutex> l(m);
+					if(s && q.empty() && rs.empty()) return;
+					while(rs.size() < n && !q.empty()){
+						Job j(std::move(q.front()));
+						q.pop();
+						l.unlock();
+						try{
+							j.p->starting();
+							j.p->launch();
+							if(j.p->waitForExit()) rs.push_back(std::move(j));
+							else done(j, nullptr);
+						}catch(...){ fail(j, std::current_exception()); }
+						l.lock();
+					}
+				}
+				bool to = 0;
+				ps.resize(rs.size() * 3 + 1);
+				ps[0] = {wk[0], POLLIN, 0};
+				for(size_t i = 0; i < rs.size(); i++){
+					rs[i].p->fds(&ps[i * 3 + 1]);
+					if(rs[i].p->pfd < 0) to = 1;
+				}
+				if(poll(&ps[0], ps.size(), to ? 100 : -1) < 0){
+					if(errno == EINTR) continue;
+					const std::exception_ptr x(std::make_exception_ptr(
+						proc::Exception(__FILE__, __LINE__, "poll on child output failed")));
+					for(Job& j : rs) fail(j, x);
+					rs.clear();
+					continue;
+				}
+				if(ps[0].revents){
+					char c[64];
+					while(read(wk[0], c, sizeof(c)) > 0);
+				}
+				for(size_t i = rs.size(); i-- > 0;){
+					Job& j(rs[i]);
+					try{
+						if(!j.p->react(&ps[i * 3 + 1], b.get())) continue;
+						j.p->waitExit();
+						j.p->exited();
+						done(j, nullptr);
+					}catch(...){ fail(j, std::current_exception()); }
+					rs.erase(rs.begin() + i);
+				}
+			}
+		}
+		void wake(){
+			const char c = 0;
+			if(write(wk[1], &c, 1)){}
+		}
+	public:
+		ProcessGroup(const unsigned int& n = kul::cpu::threads()) : n(n ? n : 1){
+			if(Process::PIPE(wk) < 0) KEXCEPT(proc::Exception, "Failed to pipe process group wake");
+			fcntl(wk[0], F_SETFL, O_NONBLOCK);
+			fcntl(wk[1], F_SETFL, O_NONBLOCK);
+			t.reset(new kul::Thread([this](){ react(); }));
+			t->name("kul.proc.group");
+			t->run();
+		}
+		~ProcessGroup(){
+			try{ wait(); }catch(...){}
+			{
+				std::lock_guard<std::mutex> l(m);
+				s = 1;
+			}
+			wake();
+			t->join();
+			Process::CLOSE(wk[0]);
+			Process::CLOSE(wk[1]);
+		}
+		ProcessGroup(const ProcessGroup&) = delete;
+		ProcessGroup& operator=(const ProcessGroup&) = delete;
+		ProcessGroup& add(const std::shared_ptr<Process>& p, const Callback& c = Callback()){
+			{
+				std::lock_guard<std::mutex> l(m);
+				q.push(Job{p, c});
+				r++;
+			}
+			wake();
+			return *this;
+		}
+		/** blocks until every added process has finished, rethrows the first exception from a callback */
+		void wait(){
+			std::unique_lock<std::mutex> l(m);
+			cv.wait(l, [this](){ return r == 0; });
+			if(e){
+				std::exception_ptr x(e);
+				e = nullptr;
+				std::rethrow_exception(x);
+			}
+		}
+};
 
 }
 #endif /* _KUL_PROC_HPP_ */
@@ -88,6 +88,7 @@ class Signal{
 
 void kul_sig_handler(int s, siginfo_t* info, void* v) {
 	if(info->si_pid == 0 || info->si_pid == kul::this_proc::id()){
+		kul::LogMan::INSTANCE().crash();
 		if(s == SIGSEGV) for(auto& f : kul::SignalStatic::INSTANCE().se) f(s);
 
 		if(!kul::SignalStatic::INSTANCE().q){
@@ -104,7 +105,7 @@ void kul_sig_handler(int s, siginfo_t* info, void* v) {
 			trace[1] = (void *) uc->uc_mcontext.gregs[REG_EIP];
 #endif
 			messages = backtrace_symbols(trace, trace_size);
-			printf("[bt] Stacktrace:\n");
+			printf("[bt] Stacktrace: %s\n", kul::this_thread::name().c_str());
 			for (i=2; i<trace_size; ++i){
 				printf("[bt] %s : ", messages[i]);
 				size_t p = 0;
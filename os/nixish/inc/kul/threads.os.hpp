@@ -38,13 +38,39 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <pthread.h>
 #include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#endif
+
+#ifndef __KUL_MUTEX_SPIN__
+	#define __KUL_MUTEX_SPIN__ 100
+#endif /*  __KUL_MUTEX_SPIN__ */
 
 namespace kul{ 
+namespace threading{
+inline std::string& NAME(){
+	static thread_local std::string n;
+	return n;
+}
+} // END NAMESPACE threading
 namespace this_thread{
-inline const std::string id(){
-	std::ostringstream os;
-	os << std::hex << pthread_self();
-	return os.str();
+inline const std::string& id(){
+	static thread_local const std::string i([](){
+		std::ostringstream os;
+		os << std::hex << pthread_self();
+		return os.str();
+	}());
+	return i;
+}
+inline void name(const std::string& n){
+	threading::NAME() = n;
+#ifdef __linux__
+	pthread_setname_np(pthread_self(), n.substr(0, 15).c_str());
+#endif
+}
+// thread label, the name if one has been set otherwise the id
+inline const std::string& name(){
+	return threading::NAME().empty() ? id() : threading::NAME();
 }
 
 //http://stackoverflow.com/questions/4867839/how-can-i-tell-if-pthread-self-is-the-main-first-thread-in-the-process
@@ -78,10 +104,94 @@ class Mutex{
 		}
 };
 
+/**
+	Non recursive mutex, spins __KUL_MUTEX_SPIN__ times before parking the thread.
+	On linux parking is a futex wait, the uncontended path never leaves user space.
+*/
+#ifdef __linux__
+class FastMutex{
+	private:
+		std::atomic<int> st; // 0 unlocked, 1 locked, 2 locked with waiters
+		void wait(){ syscall(SYS_futex, &st, FUTEX_WAIT_PRIVATE, 2, 0, 0, 0); }
+		void wake(){ syscall(SYS_futex, &st, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0); }
+	public:
+		FastMutex() : st(0){}
+		FastMutex(const FastMutex&) = delete;
+		FastMutex& operator=(const FastMutex&) = delete;
+		bool tryLock(){
+			int e = 0;
+			return st.compare_exchange_strong(e, 1, std::memory_order_acquire);
+		}
+		void lock(){
+			for(unsigned int i = 0; i < __KUL_MUTEX_SPIN__; i++)
+				if(st.load(std::memory_order_relaxed) == 0 && tryLock()) return;
+			int c = st.exchange(2, std::memory_order_acquire);
+			while(c != 0){
+				wait();
+				c = st.exchange(2, std::memory_order_acquire);
+			}
+		}
+		void unlock(){
+			if(st.exchange(0, std::memory_order_release) == 2) wake();
+		}
+};
+#else
+class FastMutex{
+	private:
+		pthread_mutex_t mute;
+	public:
+		FastMutex(){
+			pthread_mutex_init(&mute, NULL);
+		}
+		~FastMutex() {
+			pthread_mutex_destroy(&mute);
+		}
+		FastMutex(const FastMutex&) = delete;
+		FastMutex& operator=(const FastMutex&) = delete;
+		bool tryLock(){
+			return pthread_mutex_trylock(&mute) == 0;
+		}
+		void lock() {
+			for(unsigned int i = 0; i < __KUL_MUTEX_SPIN__; i++) if(tryLock()) return;
+			pthread_mutex_lock(&mute);
+		}
+		void unlock() {
+			pthread_mutex_unlock(&mute);
+		}
+};
+#endif
+
+class SharedMutex{
+	private:
+		pthread_rwlock_t rw;
+	public:
+		SharedMutex(){
+			pthread_rwlock_init(&rw, NULL);
+		}
+		~SharedMutex() {
+			pthread_rwlock_destroy(&rw);
+		}
+		SharedMutex(const SharedMutex&) = delete;
+		SharedMutex& operator=(const SharedMutex&) = delete;
+		void lock() {
+			pthread_rwlock_wrlock(&rw);
+		}
+		void unlock() {
+			pthread_rwlock_unlock(&rw);
+		}
+		void lockShared() {
+			pthread_rwlock_rdlock(&rw);
+		}
+		void unlockShared() {
+			pthread_rwlock_unlock(&rw);
+		}
+};
+
 class Thread : public threading::AThread{
 	private:
 		pthread_t thr;
 		static void* threadFunction(void* th){
+			if(((Thread*)th)->n.size()) this_thread::name(((Thread*)th)->n);
 			((Thread*)th)->act();
 			return 0;
 		}
@@ -0,0 +1,201 @@
+/**
+Copyright (c) 2013, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _KUL_IO_OS_HPP_
+#define _KUL_IO_OS_HPP_
+
+#include <windows.h>
+
+#include <memory>
+#include <string.h>
+#include <type_traits>
+
+#include "kul/os.hpp"
+#include "kul/defs.hpp"
+#include "kul/string.hpp"
+
+namespace kul{ namespace io {
+
+typedef HANDLE Descriptor;
+
+// positioned read/write, the offset is ignored for pipes
+inline long PREAD(const Descriptor& f, char* b, const size_t& n, const uint64_t& o){
+	DWORD r = 0;
+	OVERLAPPED ov = {0};
+	ov.Offset = (DWORD) o;
+	ov.OffsetHigh = (DWORD) (o >> 32);
+	if(!ReadFile(f, b, (DWORD) n, &r, GetFileType(f) == FILE_TYPE_DISK ? &ov : NULL))
+		return GetLastError() == ERROR_HANDLE_EOF || GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1;
+	return r;
+}
+inline long PWRITE(const Descriptor& f, const char* b, const size_t& n, const uint64_t& o){
+	DWORD r = 0;
+	OVERLAPPED ov = {0};
+	ov.Offset = (DWORD) o;
+	ov.OffsetHigh = (DWORD) (o >> 32);
+	if(!WriteFile(f, b, (DWORD) n, &r, GetFileType(f) == FILE_TYPE_DISK ? &ov : NULL)) return -1;
+	return r;
+}
+
+/**
+	File mapped into memory. The single argument form maps an existing file read only,
+	leaving data() null if the file cannot be mapped (empty files, pipes).
+	The sized form opens read/write, creating the file and resizing it to s bytes.
+*/
+class MemoryMap{
+	private:
+		HANDLE f, m;
+		size_t s;
+		char* p;
+		void map(const DWORD& prot, const DWORD& access){
+			ULARGE_INTEGER ul;
+			ul.QuadPart = s;
+			m = CreateFileMapping(f, NULL, prot, ul.HighPart, ul.LowPart, NULL);
+			if(m) p = (char*) MapViewOfFile(m, access, 0, 0, s);
+		}
+	public:
+		MemoryMap(const std::string& n) : m(0), s(0), p(0){
+			f = CreateFile(n.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if(f == INVALID_HANDLE_VALUE) KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be opened");
+			LARGE_INTEGER li;
+			if(GetFileType(f) == FILE_TYPE_DISK && GetFileSizeEx(f, &li)) s = li.QuadPart;
+			if(s) map(PAGE_READONLY, FILE_MAP_READ);
+		}
+		MemoryMap(const std::string& n, const size_t& s) : m(0), s(s), p(0){
+			f = CreateFile(n.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if(f == INVALID_HANDLE_VALUE) KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be opened");
+			map(PAGE_READWRITE, FILE_MAP_ALL_ACCESS);
+			if(!p){
+				if(m) CloseHandle(m);
+				CloseHandle(f);
+				KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be mapped");
+			}
+		}
+		~MemoryMap(){
+			if(p) UnmapViewOfFile(p);
+			if(m) CloseHandle(m);
+			CloseHandle(f);
+		}
+		MemoryMap(const MemoryMap&) = delete;
+		MemoryMap& operator=(const MemoryMap&) = delete;
+
+		char* data()				const { return p; }
+		const size_t& size()		const { return s; }
+		HANDLE descriptor()			const { return f; }
+		void sync(){
+			if(p) FlushViewOfFile(p, 0);
+		}
+		void sequential(){}
+		// reads n bytes at offset o without mapping
+		long read(char* b, const size_t& n, const uint64_t& o) const {
+			return PREAD(f, b, n, o);
+		}
+};
+
+/**
+	Buffered file writer with explicit flush policy. Writes are copied into a buffer of z bytes,
+	anything larger than the space left goes out straight after the pending buffer.
+	Data reaches the file when the buffer fills, on flush() and on destruction, sync() also flushes file buffers.
+	A known final size p reserves disk space up front.
+*/
+class FastWriter{
+	private:
+		HANDLE f;
+		size_t s, z;
+		std::unique_ptr<char[]> b;
+		void out(const char* c, size_t n){
+			while(n){
+				DWORD w = 0;
+				if(!WriteFile(f, c, (DWORD) (n > 0x40000000 ? 0x40000000 : n), &w, NULL))
+					KEXCEPT(fs::Exception, "FastWriter : write failed, error " + std::to_string(GetLastError()));
+				c += w;
+				n -= w;
+			}
+		}
+	public:
+		FastWriter(const std::string& n, const size_t& z = __KUL_IO_BUFFER__, const uint64_t& p = 0, bool a = 0) : s(0), z(z ? z : 1), b(new char[this->z]){
+			f = CreateFile(n.c_str(), a ? FILE_APPEND_DATA : GENERIC_WRITE, FILE_SHARE_READ, NULL, a ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if(f == INVALID_HANDLE_VALUE) KEXCEPT(fs::Exception, "File : \"" + n + "\" cannot be opened");
+			if(p){
+				FILE_ALLOCATION_INFO ai;
+				ai.AllocationSize.QuadPart = p;
+				SetFileInformationByHandle(f, FileAllocationInfo, &ai, sizeof(ai));
+			}
+		}
+		FastWriter(const File& c, const size_t& z = __KUL_IO_BUFFER__, const uint64_t& p = 0, bool a = 0) : FastWriter(c.full(), z, p, a){}
+		~FastWriter(){
+			try{ flush(); }catch(const fs::Exception&){}
+			CloseHandle(f);
+		}
+		FastWriter(const FastWriter&) = delete;
+		FastWriter& operator=(const FastWriter&) = delete;
+
+		FastWriter& write(const char* c, const size_t& n){
+			if(s + n <= z){
+				memcpy(b.get() + s, c, n);
+				s += n;
+				return *this;
+			}
+			flush();
+			out(c, n);
+			return *this;
+		}
+		FastWriter& write(const StringView& v){
+			return write(v.data(), v.size());
+		}
+		FastWriter& operator<<(const StringView& v){
+			return write(v.data(), v.size());
+		}
+		FastWriter& operator<<(const char* c){
+			return write(c, strlen(c));
+		}
+		FastWriter& operator<<(const char& c){
+			return write(&c, 1);
+		}
+		template <class T, class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+		FastWriter& operator<<(const T& t){
+			return *this << StringView(std::to_string(t));
+		}
+		void flush(){
+			if(!s) return;
+			const size_t n = s;
+			s = 0;
+			out(b.get(), n);
+		}
+		void sync(){
+			flush();
+			if(!FlushFileBuffers(f)) KEXCEPT(fs::Exception, "FastWriter : sync failed, error " + std::to_string(GetLastError()));
+		}
+		const size_t& buffered()	const { return s; }
+		HANDLE descriptor()			const { return f; }
+};
+
+}}
+#endif /* _KUL_IO_OS_HPP_ */
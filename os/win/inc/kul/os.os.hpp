@@ -32,6 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _KUL_OS_OS_HPP_
 
 #include <io.h>
+#include <string>
 #include <fstream>
 #include <stdio.h>
 #include <direct.h>
@@ -47,30 +48,103 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace kul{
 
 class Dir;
+class File;
 namespace fs {
 
-class KulTimeStampsResolver{
+class KulFileCopier{
 	private:
-		static uint FileTimeToPOSIX(FILETIME& ft){
-			LARGE_INTEGER date, adjust;
-			date.HighPart = ft.dwHighDateTime;
-			date.LowPart = ft.dwLowDateTime;
-			adjust.QuadPart = 11644473600000 * 10000;
-			date.QuadPart -= adjust.QuadPart;
-			return date.QuadPart / 10000000;
+		// CopyFile stays in the kernel and clones blocks where the volume supports it
+		static bool COPY(const char*const s, const char*const d){
+			return CopyFileA(s, d, FALSE);
 		}
-		static void GET(const char*const p, uint& a, uint& c, uint& m){
-			WIN32_FIND_DATA ffd;
-			HANDLE h = FindFirstFile(TEXT(p), &ffd);
-			if(h){
-				a = FileTimeToPOSIX(ffd.ftLastAccessTime);
-				c = FileTimeToPOSIX(ffd.ftCreationTime);
-				m = FileTimeToPOSIX(ffd.ftLastWriteTime);
-				FindClose(h);
+		friend class kul::File;
+};
+
+/**
+	Directory listing by path, a single FindFirstFileEx pass reporting each entry's type
+	from its attributes. Handles are the directory paths themselves.
+	Reparse points such as junctions are reported as files unless l is true.
+*/
+class Listing{
+	public:
+		typedef std::string Handle;
+		static Handle NONE()						{ return Handle(); }
+		static bool VALID(const Handle& h)			{ return !h.empty(); }
+		static void CLOSE(const Handle& h)			{}
+		static Handle OPEN(const Handle& h, const char* n){
+			const Handle p(h.empty() ? std::string(n) : h + "\\" + n);
+			const DWORD a = GetFileAttributesA(p.c_str());
+			return a != INVALID_FILE_ATTRIBUTES && a & FILE_ATTRIBUTE_DIRECTORY ? p : Handle();
+		}
+		static Handle PATH(const Handle& h, const char* n){
+			return OPEN(h, n);
+		}
+		// removes n relative to h, or as a path when h is NONE(), directory links are removed not followed
+		static bool UNLINK(const Handle& h, const char* n, const bool& d){
+			const Handle p(h.empty() ? std::string(n) : h + "\\" + n);
+			const DWORD a = GetFileAttributesA(p.c_str());
+			if(d || (a != INVALID_FILE_ATTRIBUTES && a & FILE_ATTRIBUTE_DIRECTORY)) return RemoveDirectoryA(p.c_str());
+			return DeleteFileA(p.c_str());
+		}
+		// calls f(const char* name, bool directory) for each entry but "." and "..", false if h cannot be read
+		template <class F> static bool LIST(const Handle& h, F f, const bool& l = 1){
+			WIN32_FIND_DATA fd;
+			HANDLE d = FindFirstFileEx((h + "\\*").c_str(), FindExInfoBasic, &fd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+			if(d == INVALID_HANDLE_VALUE) return 0;
+			do{
+				const char* n = fd.cFileName;
+				if(n[0] == '.' && (!n[1] || (n[1] == '.' && !n[2]))) continue;
+				f(n, (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+					&& (l || !(fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)));
+			}while(FindNextFile(d, &fd));
+			FindClose(d);
+			return 1;
+		}
+};
+
+/**
+	Metadata of one path from a single attribute query, relative to a Listing handle or NONE() for paths.
+	Times are nanoseconds since the epoch, changed() is the creation time, inode() is always 0.
+*/
+class Stat{
+	private:
+		bool e, d;
+		int64_t a, c, m;
+		uint64_t i, s;
+		static int64_t NANOS(const FILETIME& ft){
+			ULARGE_INTEGER ul;
+			ul.HighPart = ft.dwHighDateTime;
+			ul.LowPart = ft.dwLowDateTime;
+			return ((int64_t) ul.QuadPart - 116444736000000000LL) * 100;
+		}
+	public:
+		Stat() : e(0), d(0), a(0), c(0), m(0), i(0), s(0){}
+		bool exists()				const { return e; }
+		bool directory()			const { return d; }
+		const int64_t& accessed()	const { return a; }
+		const int64_t& changed()	const { return c; }
+		const int64_t& modified()	const { return m; }
+		const uint64_t& inode()		const { return i; }
+		const uint64_t& size()		const { return s; }
+		static Stat AT(const Listing::Handle& h, const char* n){
+			Stat r;
+			WIN32_FILE_ATTRIBUTE_DATA fa;
+			const Listing::Handle p(h.empty() ? std::string(n) : h + "\\" + n);
+			if(GetFileAttributesExA(p.c_str(), GetFileExInfoStandard, &fa)){
+				ULARGE_INTEGER ul;
+				r.e = 1;
+				r.d = fa.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+				r.a = NANOS(fa.ftLastAccessTime);
+				r.c = NANOS(fa.ftCreationTime);
+				r.m = NANOS(fa.ftLastWriteTime);
+				ul.HighPart = fa.nFileSizeHigh;
+				ul.LowPart = fa.nFileSizeLow;
+				r.s = ul.QuadPart;
 			}
+			return r;
 		}
-		friend class kul::Dir;
 };
+
 } // END NAMESPACE fs
 
 } // END NAMESPACE kul
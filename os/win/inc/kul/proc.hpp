@@ -37,6 +37,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sstream>
 #include <strsafe.h>
 #include <Windows.h> 
+#include <psapi.h>
 
 #include "kul/os.hpp"
 #include "kul/def.hpp"
@@ -71,6 +72,26 @@ class Process : public kul::AProcess{
 		HANDLE g_hChildStd_ERR_Wr = NULL;
 
 		HANDLE revent = CreateEvent(0, 1, 0, 0);
+		proc::Usage ru;
+		static uint64_t TICKS(const FILETIME& f){
+			return (((uint64_t) f.dwHighDateTime << 32) | f.dwLowDateTime) * 100;
+		}
+		void reap(HANDLE h){
+			FILETIME c, x, k, u;
+			if(GetProcessTimes(h, &c, &x, &k, &u)){
+				const uint64_t epoch = 11644473600ULL * 1000000000ULL; // 1601 to 1970
+				ru.b = TICKS(c) - epoch;
+				ru.e = TICKS(x) - epoch;
+				ru.s = TICKS(k);
+				ru.u = TICKS(u);
+			}
+			PROCESS_MEMORY_COUNTERS pm;
+			if(GetProcessMemoryInfo(h, &pm, sizeof(pm))){
+				ru.r  = pm.PeakWorkingSetSize;
+				ru.mn = pm.PageFaultCount;
+			}
+			usage(ru);
+		}
 	public:
 		Process(const std::string& cmd, const bool& wfe = true)                         : kul::AProcess(cmd, wfe)      {}
 		Process(const std::string& cmd, const std::string& path, const bool& wfe = true): kul::AProcess(cmd, path, wfe){}
@@ -226,7 +247,7 @@ class Process : public kul::AProcess{
 						}
 						if(!bSuccess || dwRead == 0) break; 
 						chBuf[dwRead] = '\0';
-						out(std::string(chBuf, dwRead));
+						out(chBuf, dwRead);
 					} 
 					for (;;) { 
 						dwRead = 0;
@@ -237,7 +258,7 @@ class Process : public kul::AProcess{
 						}
 						if(!bSuccess || dwRead == 0) break; 
 						chBuf[dwRead] = '\0';
-						err(std::string(chBuf, dwRead));
+						err(chBuf, dwRead);
 					} 
 				}while(alive);
 			}
@@ -247,6 +268,7 @@ class Process : public kul::AProcess{
 				if (FALSE == GetExitCodeProcess(piProcInfo.hProcess, &ec))
 					KEXCEPT(kul::proc::Exception, "GetExitCodeProcess failure");
 				exitCode(ec);
+				reap(piProcInfo.hProcess);
 				finish();
 				setFinished();
 			}
@@ -254,6 +276,31 @@ class Process : public kul::AProcess{
 			CloseHandle(piProcInfo.hProcess);
 		}
 	};
+
+/**
+	Runs queued processes, at most n at a time, each waited on by a kul::TaskGroup worker.
+	Callbacks are invoked on that worker after exit, with the exception from start() if any.
+*/
+class ProcessGroup{
+	public:
+		typedef std::function<void(Process&, const std::exception_ptr&)> Callback;
+	private:
+		kul::TaskGroup g;
+	public:
+		ProcessGroup(const unsigned int& n = kul::cpu::threads()) : g(n){}
+		ProcessGroup& add(const std::shared_ptr<Process>& p, const Callback& c = Callback()){
+			g.add([p, c](){
+				std::exception_ptr e;
+				try{
+					p->start();
+				}catch(...){ e = std::current_exception(); }
+				if(c) c(*p, e);
+			});
+			return *this;
+		}
+		/** blocks until every added process has finished, rethrows the first exception from a callback */
+		void wait(){ g.wait(); }
+};
 }
 
 #endif /* _KUL_PROC_HPP_ */
@@ -82,6 +82,7 @@ class Signal{
 }
 
 void kul_real_se_handler(EXCEPTION_POINTERS* pExceptionInfo){
+	kul::LogMan::INSTANCE().crash();
 	const std::string& tid(kul::this_thread::id());
 	uint sig = pExceptionInfo->ExceptionRecord->ExceptionCode;
 	if(pExceptionInfo->ExceptionRecord->ExceptionCode == EXCEPTION_ACCESS_VIOLATION)
@@ -114,7 +115,7 @@ void kul_real_se_handler(EXCEPTION_POINTERS* pExceptionInfo){
 	    symbol               = ( SYMBOL_INFO * )calloc( sizeof( SYMBOL_INFO ) + 256 * sizeof( char ), 1 );
 	    symbol->MaxNameLen   = 255;
 	    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
-	    std::cout << "[bt] Stacktrace:" << std::endl;
+	    std::cout << "[bt] Stacktrace: " << kul::this_thread::name() << std::endl;
 	    while (StackWalk64(machine_type,
 	        GetCurrentProcess(),
 	        GetCurrentThread(),
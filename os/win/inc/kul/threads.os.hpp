@@ -37,11 +37,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <TlHelp32.h>
 
 namespace kul{ 
+namespace threading{
+inline std::string& NAME(){
+	static thread_local std::string n;
+	return n;
+}
+} // END NAMESPACE threading
 namespace this_thread{
-inline const std::string id(){
-	std::ostringstream os;
-	os << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id());
-	return os.str();
+inline const std::string& id(){
+	static thread_local const std::string i([](){
+		std::ostringstream os;
+		os << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id());
+		return os.str();
+	}());
+	return i;
+}
+inline void name(const std::string& n){
+	threading::NAME() = n;
+}
+// thread label, the name if one has been set otherwise the id
+inline const std::string& name(){
+	return threading::NAME().empty() ? id() : threading::NAME();
 }
 inline bool main(){
 	const std::tr1::shared_ptr<void> hThreadSnapshot(CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0), CloseHandle);
@@ -86,6 +102,49 @@ class Mutex{
 		}
 };
 
+class FastMutex{
+	private:
+		SRWLOCK srw;
+	public:
+		FastMutex(){
+			InitializeSRWLock(&srw);
+		}
+		FastMutex(const FastMutex&) = delete;
+		FastMutex& operator=(const FastMutex&) = delete;
+		bool tryLock(){
+			return TryAcquireSRWLockExclusive(&srw);
+		}
+		void lock() {
+			AcquireSRWLockExclusive(&srw);
+		}
+		void unlock() {
+			ReleaseSRWLockExclusive(&srw);
+		}
+};
+
+class SharedMutex{
+	private:
+		SRWLOCK srw;
+	public:
+		SharedMutex(){
+			InitializeSRWLock(&srw);
+		}
+		SharedMutex(const SharedMutex&) = delete;
+		SharedMutex& operator=(const SharedMutex&) = delete;
+		void lock() {
+			AcquireSRWLockExclusive(&srw);
+		}
+		void unlock() {
+			ReleaseSRWLockExclusive(&srw);
+		}
+		void lockShared() {
+			AcquireSRWLockShared(&srw);
+		}
+		void unlockShared() {
+			ReleaseSRWLockShared(&srw);
+		}
+};
+
 namespace threading{
 DWORD WINAPI threadFunction(LPVOID th);
 }
@@ -122,6 +181,7 @@ class Thread : public threading::AThread{
 
 namespace threading{
 inline DWORD WINAPI threadFunction(LPVOID th){
+	if(reinterpret_cast<Thread*>(th)->n.size()) this_thread::name(reinterpret_cast<Thread*>(th)->n);
 	reinterpret_cast<Thread*>(th)->act(); 	
 	return 0;
 }